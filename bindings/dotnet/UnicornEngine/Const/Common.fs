@@ -137,6 +137,13 @@ module Common =
     let UC_TLB_CPU = 0
     let UC_TLB_VIRTUAL = 1
 
+    let UC_SNAPSHOT_REGION = 0
+    let UC_SNAPSHOT_PAGE = 1
+
+    let UC_TB_IC_NONE = 0
+    let UC_TB_IC_INDIRECT = 1
+    let UC_TB_IC_RETURN = 2
+
     let UC_CTL_UC_MODE = 0
     let UC_CTL_UC_PAGE_SIZE = 1
     let UC_CTL_UC_ARCH = 2
@@ -152,6 +159,16 @@ module Common =
     let UC_CTL_TLB_TYPE = 12
     let UC_CTL_TCG_BUFFER_SIZE = 13
     let UC_CTL_CONTEXT_MODE = 14
+    let UC_CTL_SNAPSHOT_TYPE = 15
+    let UC_CTL_TB_CACHE_EXPORT = 16
+    let UC_CTL_TB_CACHE_IMPORT = 17
+    let UC_CTL_TB_REQUEST_CACHE_BATCH = 18
+    let UC_CTL_TB_INLINE_CACHE = 19
+    let UC_CTL_TB_SUPERBLOCK = 20
+    let UC_RESET_MEMORY = 1
+    let UC_RESET_HOOKS = 2
+    let UC_RESET_TB_CACHE = 4
+    let UC_RESET_ALL = 7
     let UC_CTL_CONTEXT_CPU = 1
     let UC_CTL_CONTEXT_MEMORY = 2
 
@@ -132,6 +132,13 @@ const (
 	TLB_CPU = 0
 	TLB_VIRTUAL = 1
 
+	SNAPSHOT_REGION = 0
+	SNAPSHOT_PAGE = 1
+
+	TB_IC_NONE = 0
+	TB_IC_INDIRECT = 1
+	TB_IC_RETURN = 2
+
 	CTL_UC_MODE = 0
 	CTL_UC_PAGE_SIZE = 1
 	CTL_UC_ARCH = 2
@@ -147,6 +154,16 @@ const (
 	CTL_TLB_TYPE = 12
 	CTL_TCG_BUFFER_SIZE = 13
 	CTL_CONTEXT_MODE = 14
+	CTL_SNAPSHOT_TYPE = 15
+	CTL_TB_CACHE_EXPORT = 16
+	CTL_TB_CACHE_IMPORT = 17
+	CTL_TB_REQUEST_CACHE_BATCH = 18
+	CTL_TB_INLINE_CACHE = 19
+	CTL_TB_SUPERBLOCK = 20
+	RESET_MEMORY = 1
+	RESET_HOOKS = 2
+	RESET_TB_CACHE = 4
+	RESET_ALL = 7
 	CTL_CONTEXT_CPU = 1
 	CTL_CONTEXT_MEMORY = 2
 )
\ No newline at end of file
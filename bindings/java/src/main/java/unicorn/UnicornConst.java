@@ -134,6 +134,13 @@ public interface UnicornConst {
     public static final int UC_TLB_CPU = 0;
     public static final int UC_TLB_VIRTUAL = 1;
 
+    public static final int UC_SNAPSHOT_REGION = 0;
+    public static final int UC_SNAPSHOT_PAGE = 1;
+
+    public static final int UC_TB_IC_NONE = 0;
+    public static final int UC_TB_IC_INDIRECT = 1;
+    public static final int UC_TB_IC_RETURN = 2;
+
     public static final int UC_CTL_UC_MODE = 0;
     public static final int UC_CTL_UC_PAGE_SIZE = 1;
     public static final int UC_CTL_UC_ARCH = 2;
@@ -149,6 +156,16 @@ public interface UnicornConst {
     public static final int UC_CTL_TLB_TYPE = 12;
     public static final int UC_CTL_TCG_BUFFER_SIZE = 13;
     public static final int UC_CTL_CONTEXT_MODE = 14;
+    public static final int UC_CTL_SNAPSHOT_TYPE = 15;
+    public static final int UC_CTL_TB_CACHE_EXPORT = 16;
+    public static final int UC_CTL_TB_CACHE_IMPORT = 17;
+    public static final int UC_CTL_TB_REQUEST_CACHE_BATCH = 18;
+    public static final int UC_CTL_TB_INLINE_CACHE = 19;
+    public static final int UC_CTL_TB_SUPERBLOCK = 20;
+    public static final int UC_RESET_MEMORY = 1;
+    public static final int UC_RESET_HOOKS = 2;
+    public static final int UC_RESET_TB_CACHE = 4;
+    public static final int UC_RESET_ALL = 7;
     public static final int UC_CTL_CONTEXT_CPU = 1;
     public static final int UC_CTL_CONTEXT_MEMORY = 2;
 
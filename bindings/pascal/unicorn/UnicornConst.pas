@@ -135,6 +135,13 @@ const  UC_API_MAJOR = 2;
   UC_TLB_CPU = 0;
   UC_TLB_VIRTUAL = 1;
 
+  UC_SNAPSHOT_REGION = 0;
+  UC_SNAPSHOT_PAGE = 1;
+
+  UC_TB_IC_NONE = 0;
+  UC_TB_IC_INDIRECT = 1;
+  UC_TB_IC_RETURN = 2;
+
   UC_CTL_UC_MODE = 0;
   UC_CTL_UC_PAGE_SIZE = 1;
   UC_CTL_UC_ARCH = 2;
@@ -150,6 +157,16 @@ const  UC_API_MAJOR = 2;
   UC_CTL_TLB_TYPE = 12;
   UC_CTL_TCG_BUFFER_SIZE = 13;
   UC_CTL_CONTEXT_MODE = 14;
+  UC_CTL_SNAPSHOT_TYPE = 15;
+  UC_CTL_TB_CACHE_EXPORT = 16;
+  UC_CTL_TB_CACHE_IMPORT = 17;
+  UC_CTL_TB_REQUEST_CACHE_BATCH = 18;
+  UC_CTL_TB_INLINE_CACHE = 19;
+  UC_CTL_TB_SUPERBLOCK = 20;
+  UC_RESET_MEMORY = 1;
+  UC_RESET_HOOKS = 2;
+  UC_RESET_TB_CACHE = 4;
+  UC_RESET_ALL = 7;
   UC_CTL_CONTEXT_CPU = 1;
   UC_CTL_CONTEXT_MEMORY = 2;
 
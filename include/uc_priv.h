@@ -109,6 +109,8 @@ typedef MemoryRegion *(*uc_args_uc_ram_size_ptr_t)(struct uc_struct *,
                                                    uint32_t perms, void *ptr);
 
 typedef void (*uc_mem_unmap_t)(struct uc_struct *, MemoryRegion *mr);
+typedef void (*uc_mem_unmap_batch_t)(struct uc_struct *, MemoryRegion **blocks,
+                                     size_t count);
 
 typedef MemoryRegion *(*uc_memory_mapping_t)(struct uc_struct *, hwaddr addr);
 
@@ -152,6 +154,31 @@ typedef void (*uc_invalidate_tb_t)(struct uc_struct *uc, uint64_t start,
 // Request generating TB at given address
 typedef uc_err (*uc_gen_tb_t)(struct uc_struct *uc, uint64_t pc, uc_tb *out_tb);
 
+// Translation state a TB was generated for, see UC_CTL_TB_CACHE_EXPORT
+typedef struct uc_tb_key {
+    uint64_t pc;
+    uint64_t cs_base;
+    uint32_t flags;
+    uint32_t cflags;
+    uint32_t size; // guest bytes covered by the TB
+} uc_tb_key;
+
+typedef void (*uc_tb_key_cb_t)(struct uc_struct *uc, const uc_tb_key *key,
+                               void *opaque);
+
+// Call cb for every valid TB in the TB cache
+typedef void (*uc_tb_foreach_t)(struct uc_struct *uc, uc_tb_key_cb_t cb,
+                                void *opaque);
+
+// Request generating the TBs at a list of addresses and their successors
+typedef uc_err (*uc_gen_tb_batch_t)(struct uc_struct *uc, const uint64_t *addrs,
+                                    size_t count, uint32_t depth,
+                                    size_t budget, size_t *generated,
+                                    size_t *used);
+
+// Request generating the TB of a given translation state
+typedef uc_err (*uc_gen_tb_key_t)(struct uc_struct *uc, const uc_tb_key *key);
+
 // tb flush
 typedef uc_tcg_flush_tlb uc_tb_flush_t;
 
@@ -251,17 +278,34 @@ typedef enum uc_hook_idx {
 
 #define HOOK_EXISTS(uc, idx) ((uc)->hook[idx##_IDX].head != NULL)
 #define HOOK_EXISTS_BOUNDED(uc, idx, addr)                                     \
-    _hook_exists_bounded((uc)->hook[idx##_IDX].head, addr)
+    hook_index_exists((uc), idx##_IDX, addr, addr)
+
+#define HOOK_FOREACH_BOUNDED_VAR_DECLARE struct hook **hcur, **hend
+
+// for loop macro to loop over the hooks of a list whose bounds may contain
+// addr, in the same order as HOOK_FOREACH. HOOK_BOUND_CHECK is still needed
+// since a hook deleted during the loop is only flagged with to_delete.
+#define HOOK_FOREACH_BOUNDED(uc, hh, idx, addr)                                \
+    for (hcur = hook_index_lookup((uc), idx##_IDX, addr, &hend);               \
+         hcur < hend && ((hh) = *hcur); hcur++)
+
+#define HOOK_EXISTS_OVERLAP(uc, idx, begin, end)                               \
+    hook_index_exists((uc), idx##_IDX, begin, end)
+
+// Interval index over the hooks of one list, so that dispatch only visits the
+// hooks whose bounds contain the address. The address space is cut into
+// segments at every hook boundary and each segment records, in list order,
+// the hooks covering it. The index is rebuilt lazily once uc->hooks_gen moves.
+struct hook_index {
+    uint32_t gen;        // uc->hooks_gen this index was built for
+    uint32_t nseg;       // number of segments, at least 1
+    uint64_t *starts;    // first address of each segment, starts[0] == 0
+    struct hook **hooks; // hooks of all segments, back to back
+    uint32_t *offs;      // hooks of segment i are hooks[offs[i]..offs[i+1])
+    void *mem;           // single allocation backing the arrays above
+};
 
-static inline bool _hook_exists_bounded(struct list_item *cur, uint64_t addr)
-{
-    while (cur != NULL) {
-        if (HOOK_BOUND_CHECK((struct hook *)cur->data, addr))
-            return true;
-        cur = cur->next;
-    }
-    return false;
-}
+void hook_index_rebuild(struct uc_struct *uc, int idx);
 
 // relloc increment, KEEP THIS A POWER OF 2!
 #define MEM_BLOCK_INCR 32
@@ -303,6 +347,11 @@ struct uc_struct {
     uc_mem_unmap_t memory_unmap;
     uc_mem_unmap_t memory_moveout;
     uc_mem_unmap_t memory_movein;
+    uc_args_uc_t memory_restore_pages;
+    uc_args_uc_t memory_reset;
+    uc_mem_unmap_batch_t memory_unmap_batch;
+    uc_args_uc_t memory_transaction_begin;
+    uc_args_uc_t memory_transaction_commit;
     uc_readonly_mem_t readonly_mem;
     uc_cpus_init cpus_init;
     uc_target_page_init target_page;
@@ -310,6 +359,9 @@ struct uc_struct {
     uc_tcg_flush_tlb tcg_flush_tlb;
     uc_invalidate_tb_t uc_invalidate_tb;
     uc_gen_tb_t uc_gen_tb;
+    uc_gen_tb_batch_t uc_gen_tb_batch;
+    uc_tb_foreach_t uc_tb_foreach;
+    uc_gen_tb_key_t uc_gen_tb_key;
     uc_tb_flush_t tb_flush;
     uc_add_inline_hook_t add_inline_hook;
     uc_del_inline_hook_t del_inline_hook;
@@ -355,6 +407,7 @@ struct uc_struct {
     QTAILQ_HEAD(, AddressSpace) address_spaces;
     GHashTable *flat_views;
     bool memory_region_update_pending;
+    int memory_region_transaction_depth; // see memory_transaction_begin()
 
     uc_set_tlb_t set_tlb;
 
@@ -363,9 +416,12 @@ struct uc_struct {
     struct list hooks_to_del;
     int hooks_count[UC_HOOK_MAX];
 
-    // hook to count number of instructions for uc_emu_start()
-    uc_hook count_hook;
+    // per list interval index, see hook_index_lookup()
+    struct hook_index hook_index[UC_HOOK_MAX];
+    uint32_t hooks_gen;              // bumped whenever the hook set changes
+    struct list hook_index_retired;  // indexes replaced during emulation
 
+    // instruction budget of uc_emu_start(), charged per TB
     size_t emu_counter; // current counter of uc_emu_start()
     size_t emu_count;   // save counter of uc_emu_start()
 
@@ -379,8 +435,10 @@ struct uc_struct {
     bool emulation_done; // emulation is done by uc_emu_start()
     bool timed_out;      // emulation timed out, that can retrieve via
                          // uc_query(UC_QUERY_TIMEOUT)
-    QemuThread timer;    // timer for emulation timeout
     uint64_t timeout;    // timeout for uc_emu_start()
+    int64_t timeout_deadline; // get_clock() deadline of the running
+                              // uc_emu_start(), 0 if no timeout
+    uint32_t timeout_poll;    // TBs left until the deadline is checked again
 
     uint64_t invalid_addr; // invalid address to be accessed
     int invalid_error;     // invalid memory code: 1 = READ, 2 = WRITE, 3 = CODE
@@ -422,18 +480,37 @@ struct uc_struct {
     FlatView *empty_view; // Static function variable moved from flatviews_init
 
     uint32_t tcg_buffer_size; // The buffer size we are going to use
+    int tb_inline_cache; // uc_tb_inline_cache flags, see UC_CTL_TB_INLINE_CACHE
+    uint32_t tb_superblock_threshold; // see UC_CTL_TB_SUPERBLOCK, 0 is off
+    size_t tb_superblocks; // superblocks translated since the last TB flush
+    uint8_t *coverage_map; // see UC_CTL_COVERAGE_BITMAP, NULL is off
+    size_t coverage_size;  // a power of 2
 #ifdef WIN32
     PVOID seh_handle;
     void *seh_closure;
 #endif
     GArray *unmapped_regions;
     int32_t snapshot_level;
+    uc_snapshot_type snapshot_type;
+    GArray *snapshot_pages;   // struct uc_snapshot_page, see memory_cow
+    uint8_t *snapshot_pool;   // page content of snapshot_pages
+    size_t snapshot_pool_len; // capacity of snapshot_pool in pages
+    uint32_t snapshot_gen;    // bumped on every snapshot and restore
     uint64_t nested; // the nested level of all exposed API
     bool thread_executable_entry;
     bool current_executable;
     bool skip_sync_pc_on_exit;
 };
 
+// A page saved by the UC_SNAPSHOT_PAGE backend, its content lives at the same
+// index in uc->snapshot_pool.
+struct uc_snapshot_page {
+    MemoryRegion *mr; // the RAM region the page belongs to
+    hwaddr offset;    // page offset within mr
+    hwaddr addr;      // guest physical address of the page
+    int32_t level;    // snapshot level the page was saved at
+};
+
 // Metadata stub for the variable-size cpu context used with uc_context_*()
 struct uc_context {
     size_t context_size;  // size of the real internal context structure
@@ -470,6 +547,60 @@ typedef struct HookedRegion {
     uint64_t length;
 } HookedRegion;
 
+// Return the segment of the index of list idx which contains addr.
+static inline uint32_t hook_index_segment(struct uc_struct *uc, int idx,
+                                          uint64_t addr)
+{
+    struct hook_index *hi = &uc->hook_index[idx];
+    uint32_t lo, up, mid;
+
+    if (hi->gen != uc->hooks_gen) {
+        hook_index_rebuild(uc, idx);
+    }
+
+    // last segment starting at or before addr
+    lo = 0;
+    up = hi->nseg - 1;
+    while (lo < up) {
+        mid = lo + (up - lo + 1) / 2;
+        if (hi->starts[mid] <= addr) {
+            lo = mid;
+        } else {
+            up = mid - 1;
+        }
+    }
+    return lo;
+}
+
+// Return the hooks of list idx whose bounds contain addr, the end of the
+// range is stored to *end.
+static inline struct hook **hook_index_lookup(struct uc_struct *uc, int idx,
+                                              uint64_t addr, struct hook ***end)
+{
+    uint32_t seg = hook_index_segment(uc, idx, addr);
+    struct hook_index *hi = &uc->hook_index[idx];
+
+    *end = hi->hooks + hi->offs[seg + 1];
+    return hi->hooks + hi->offs[seg];
+}
+
+// Whether any hook of list idx intersects [begin, end]
+static inline bool hook_index_exists(struct uc_struct *uc, int idx,
+                                     uint64_t begin, uint64_t end)
+{
+    uint32_t seg = hook_index_segment(uc, idx, begin);
+    struct hook_index *hi = &uc->hook_index[idx];
+
+    do {
+        if (hi->offs[seg] != hi->offs[seg + 1]) {
+            return true;
+        }
+        seg++;
+    } while (seg < hi->nseg && hi->starts[seg] <= end);
+
+    return false;
+}
+
 // hooked_regions related functions
 static inline guint hooked_regions_hash(const void *p)
 {
@@ -501,11 +632,21 @@ static inline void hooked_regions_add(struct hook *h, uint64_t start,
     }
 }
 
+// Whether hook h may be called somewhere in [start, start + length)
+static inline bool hooked_regions_overlap(struct hook *h, uint64_t start,
+                                          uint64_t length)
+{
+    uint64_t last = length ? start + length - 1 : start;
+
+    return (h->begin > h->end || (h->begin <= last && h->end >= start)) &&
+           !h->to_delete;
+}
+
 static inline void hooked_regions_check_single(struct list_item *cur,
                                                uint64_t start, uint64_t length)
 {
     while (cur != NULL) {
-        if (HOOK_BOUND_CHECK((struct hook *)cur->data, start)) {
+        if (hooked_regions_overlap((struct hook *)cur->data, start, length)) {
             hooked_regions_add((struct hook *)cur->data, start, length);
         }
         cur = cur->next;
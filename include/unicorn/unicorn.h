@@ -543,6 +543,33 @@ typedef enum uc_tlb_type {
     UC_TLB_VIRTUAL
 } uc_tlb_type;
 
+// unicorn memory snapshot backend selection, see UC_CTL_CONTEXT_MEMORY
+typedef enum uc_snapshot_type {
+    // The default backend.
+    // Every page written after a snapshot gets its own copy-on-write
+    // memory region, restoring removes those regions again.
+    UC_SNAPSHOT_REGION = 0,
+    // The original content of every page written after a snapshot is
+    // saved to a flat page pool, restoring copies the dirty pages back
+    // and leaves the memory layout untouched. This is faster when many
+    // pages are dirtied between a snapshot and its restore.
+    UC_SNAPSHOT_PAGE
+} uc_snapshot_type;
+
+// Inline caches of indirect jumps, see UC_CTL_TB_INLINE_CACHE. These are
+// flags and can be combined.
+typedef enum uc_tb_inline_cache {
+    // Indirect jumps always look their destination up in the TB cache.
+    // The default.
+    UC_TB_IC_NONE = 0,
+    // Indirect jumps and calls remember their last two destinations and
+    // jump there directly when they match.
+    UC_TB_IC_INDIRECT = 1,
+    // Calls push their return address on a shadow stack, returns jump
+    // directly back to the call site when the popped address matches.
+    UC_TB_IC_RETURN = 2,
+} uc_tb_inline_cache;
+
 // All type of controls for uc_ctl API.
 // The controls are organized in a tree level.
 // If a control don't have `Set` or `Get` for @args, it means it's r/o or w/o.
@@ -605,6 +632,59 @@ typedef enum uc_control_type {
     // controle if context_save/restore should work with snapshots
     // Write: @args = (int)
     UC_CTL_CONTEXT_MODE,
+    // Change the memory snapshot backend, can't be changed while a
+    // snapshot is active.
+    // see uc_snapshot_type for current implemented types
+    // Write: @args = (int)
+    // Read: @args = (int*)
+    UC_CTL_SNAPSHOT_TYPE,
+    // Save the translation state of the cached TBs to a file, together with
+    // a hash of their guest code. The file is only meant for engines of the
+    // same build, arch, mode and cpu model on the same host.
+    // Write: @args = (const char *path)
+    UC_CTL_TB_CACHE_EXPORT,
+    // Translate the TBs saved by UC_CTL_TB_CACHE_EXPORT ahead of emulation.
+    // Entries whose guest code no longer matches are skipped.
+    // Read: @args = (const char *path, size_t *count), @count may be NULL and
+    //       receives the number of TBs loaded.
+    UC_CTL_TB_CACHE_IMPORT,
+    // Request tb caches at a list of addresses. With @depth > 0 the direct
+    // branch targets and fall-through addresses of every new tb are requested
+    // as well, up to @depth levels away from the given addresses. Requesting
+    // stops once @budget bytes of the translation buffer are used, 0 means no
+    // limit. @generated and @used may be NULL.
+    // Read: @args = (const uint64_t *addrs, size_t count, uint32_t depth,
+    //                size_t budget, size_t *generated, size_t *used)
+    UC_CTL_TB_REQUEST_CACHE_BATCH,
+    // Select the inline caches generated for indirect jumps, calls and
+    // returns, see uc_tb_inline_cache. Changing them flushes all TBs.
+    // Supported for x86, ARM, ARM64, MIPS and RISC-V, other archs ignore it.
+    // Note that like direct jumps between TBs, the cached jumps assume that
+    // hooks don't change the CPU mode in the middle of a TB.
+    // Write: @args = (int)
+    // Read: @args = (int*)
+    UC_CTL_TB_INLINE_CACHE,
+    // Retranslate a TB once it has run @threshold times into a superblock
+    // that goes on through the direct jumps after it and the more frequent
+    // side of its conditional branches, 0 (the default) turns this off.
+    // Changing the threshold flushes all TBs. Superblocks aren't built where
+    // code or block hooks apply or while uc_emu_start() has a @count, and
+    // an outermost uc_emu_start() with a @count drops them first.
+    // Supported for x86 and ARM64, otherwise UC_ERR_ARCH is returned.
+    // Write: @args = (uint32_t threshold)
+    // Read: @args = (uint32_t *threshold)
+    UC_CTL_TB_SUPERBLOCK,
+    // Count the edges between blocks into an AFL style bitmap without any
+    // callback: every block does map[prev_loc ^ cur_loc]++ and then
+    // prev_loc = cur_loc >> 1, where cur_loc is
+    // ((address >> 4) ^ (address << 8)) & (size - 1). prev_loc restarts at 0
+    // with every outermost uc_emu_start().
+    // @size must be a power of 2, a NULL @map turns the bitmap off. Changing
+    // the bitmap flushes all TBs, and no superblocks are built while it is
+    // on, see UC_CTL_TB_SUPERBLOCK.
+    // Write: @args = (uint8_t *map, size_t size)
+    // Read: @args = (uint8_t **map, size_t *size)
+    UC_CTL_COVERAGE_BITMAP,
 } uc_control_type;
 
 /*
@@ -678,6 +758,15 @@ See sample_ctl.c for a detailed example.
     uc_ctl(uc, UC_CTL_WRITE(UC_CTL_TB_REMOVE_CACHE, 2), (address), (end))
 #define uc_ctl_request_cache(uc, address, tb)                                  \
     uc_ctl(uc, UC_CTL_READ_WRITE(UC_CTL_TB_REQUEST_CACHE, 2), (address), (tb))
+#define uc_ctl_request_cache_batch(uc, addrs, count, depth, budget, generated, \
+                                   used)                                       \
+    uc_ctl(uc, UC_CTL_READ_WRITE(UC_CTL_TB_REQUEST_CACHE_BATCH, 6), (addrs),   \
+           (size_t)(count), (uint32_t)(depth), (size_t)(budget), (generated),  \
+           (used))
+#define uc_ctl_tb_cache_export(uc, path)                                       \
+    uc_ctl(uc, UC_CTL_WRITE(UC_CTL_TB_CACHE_EXPORT, 1), (path))
+#define uc_ctl_tb_cache_import(uc, path, count)                                \
+    uc_ctl(uc, UC_CTL_READ_WRITE(UC_CTL_TB_CACHE_IMPORT, 2), (path), (count))
 #define uc_ctl_flush_tb(uc) uc_ctl(uc, UC_CTL_WRITE(UC_CTL_TB_FLUSH, 0))
 #define uc_ctl_flush_tlb(uc) uc_ctl(uc, UC_CTL_WRITE(UC_CTL_TLB_FLUSH, 0))
 #define uc_ctl_tlb_mode(uc, mode)                                              \
@@ -688,6 +777,22 @@ See sample_ctl.c for a detailed example.
     uc_ctl(uc, UC_CTL_WRITE(UC_CTL_TCG_BUFFER_SIZE, 1), (size))
 #define uc_ctl_context_mode(uc, mode)                                          \
     uc_ctl(uc, UC_CTL_WRITE(UC_CTL_CONTEXT_MODE, 1), (mode))
+#define uc_ctl_snapshot_mode(uc, mode)                                         \
+    uc_ctl(uc, UC_CTL_WRITE(UC_CTL_SNAPSHOT_TYPE, 1), (mode))
+#define uc_ctl_get_snapshot_mode(uc, mode)                                     \
+    uc_ctl(uc, UC_CTL_READ(UC_CTL_SNAPSHOT_TYPE, 1), (mode))
+#define uc_ctl_tb_inline_cache(uc, flags)                                      \
+    uc_ctl(uc, UC_CTL_WRITE(UC_CTL_TB_INLINE_CACHE, 1), (flags))
+#define uc_ctl_get_tb_inline_cache(uc, flags)                                  \
+    uc_ctl(uc, UC_CTL_READ(UC_CTL_TB_INLINE_CACHE, 1), (flags))
+#define uc_ctl_tb_superblock(uc, threshold)                                    \
+    uc_ctl(uc, UC_CTL_WRITE(UC_CTL_TB_SUPERBLOCK, 1), (threshold))
+#define uc_ctl_get_tb_superblock(uc, threshold)                                \
+    uc_ctl(uc, UC_CTL_READ(UC_CTL_TB_SUPERBLOCK, 1), (threshold))
+#define uc_ctl_coverage_bitmap(uc, map, size)                                  \
+    uc_ctl(uc, UC_CTL_WRITE(UC_CTL_COVERAGE_BITMAP, 2), (map), (size_t)(size))
+#define uc_ctl_get_coverage_bitmap(uc, map, size)                              \
+    uc_ctl(uc, UC_CTL_READ(UC_CTL_COVERAGE_BITMAP, 2), (map), (size))
 
 // Opaque storage for CPU context, used with uc_context_*()
 struct uc_context;
@@ -750,6 +855,37 @@ uc_err uc_open(uc_arch arch, uc_mode mode, uc_engine **uc);
 UNICORN_EXPORT
 uc_err uc_close(uc_engine *uc);
 
+// What uc_reset() should drop besides the CPU state
+typedef enum uc_reset_type {
+    // Unmap all memory, including MMIO, and discard memory snapshots.
+    UC_RESET_MEMORY = 1 << 0,
+    // Delete all hooks.
+    UC_RESET_HOOKS = 1 << 1,
+    // Discard the translation cache, which is kept by default.
+    UC_RESET_TB_CACHE = 1 << 2,
+    UC_RESET_ALL = UC_RESET_MEMORY | UC_RESET_HOOKS | UC_RESET_TB_CACHE,
+} uc_reset_type;
+
+/*
+ Reset a Unicorn engine instance to the state uc_open() left it in, without
+ paying for a new instance. The CPU is reset and the exits and the timeout
+ state are cleared; settings made with uc_ctl() are kept.
+
+ By default the memory, the hooks and the translated code are kept, so that
+ an engine restored to a memory baseline (see uc_context_restore() with
+ UC_CTL_CONTEXT_MEMORY) runs the same code again without translating it.
+ This must not be called while emulating. Contexts saved with
+ UC_CTL_CONTEXT_MEMORY before UC_RESET_MEMORY must not be restored afterwards.
+
+ @uc: handle returned by uc_open()
+ @flags: what else to reset, a combination of uc_reset_type values
+
+ @return UC_ERR_OK on success, or other value on failure (refer to uc_err enum
+   for detailed error).
+*/
+UNICORN_EXPORT
+uc_err uc_reset(uc_engine *uc, int flags);
+
 /*
  Query internal status of engine.
 
@@ -1025,6 +1161,92 @@ UNICORN_EXPORT
 uc_err uc_vmem_translate(uc_engine *uc, uint64_t address, uc_prot prot,
                               uint64_t *paddress);
 
+/*
+ Read multiple ranges of bytes in memory.
+
+ @uc: handle returned by uc_open()
+ @addrs: array of starting memory addresses of bytes to get.
+ @bufs:  array of pointers to variables receiving the data copied from memory.
+ @sizes: array of sizes of memory to read.
+ @errs:  array receiving the result of each read, may be NULL.
+ @count: length of *addrs, *bufs, *sizes and *errs
+
+ NOTE: each @bufs[i] must be big enough to contain @sizes[i] bytes. All the
+ ranges are read even if some of them fail.
+
+ @return UC_ERR_OK if all the ranges were read, or the error of the first
+   range which failed (refer to uc_err enum for detailed error).
+*/
+UNICORN_EXPORT
+uc_err uc_mem_read_batch(uc_engine *uc, const uint64_t *addrs,
+                         void *const *bufs, const size_t *sizes, uc_err *errs,
+                         int count);
+
+/*
+ Write to multiple ranges of bytes in memory.
+
+ @uc: handle returned by uc_open()
+ @addrs: array of starting memory addresses of bytes to set.
+ @bufs:  array of pointers to variables containing data to be written.
+ @sizes: array of sizes of memory to write to.
+ @errs:  array receiving the result of each write, may be NULL.
+ @count: length of *addrs, *bufs, *sizes and *errs
+
+ NOTE: each @bufs[i] must be big enough to contain @sizes[i] bytes. All the
+ ranges are written even if some of them fail.
+
+ @return UC_ERR_OK if all the ranges were written, or the error of the first
+   range which failed (refer to uc_err enum for detailed error).
+*/
+UNICORN_EXPORT
+uc_err uc_mem_write_batch(uc_engine *uc, const uint64_t *addrs,
+                          const void *const *bufs, const size_t *sizes,
+                          uc_err *errs, int count);
+
+/*
+ Read multiple ranges of bytes in memory after mmu translation.
+
+ @uc: handle returned by uc_open()
+ @addrs: array of starting virtual memory addresses of bytes to get.
+ @prot:  The access type for the tlb lookup
+ @bufs:  array of pointers to variables receiving the data copied from memory.
+ @sizes: array of sizes of memory to read.
+ @errs:  array receiving the result of each read, may be NULL.
+ @count: length of *addrs, *bufs, *sizes and *errs
+
+ See uc_vmem_read() for the translation and uc_mem_read_batch() for the
+ handling of errors.
+
+ @return UC_ERR_OK if all the ranges were read, or the error of the first
+   range which failed (refer to uc_err enum for detailed error).
+*/
+UNICORN_EXPORT
+uc_err uc_vmem_read_batch(uc_engine *uc, const uint64_t *addrs, uc_prot prot,
+                          void *const *bufs, const size_t *sizes, uc_err *errs,
+                          int count);
+
+/*
+ Write to multiple ranges of bytes in memory after mmu translation.
+
+ @uc: handle returned by uc_open()
+ @addrs: array of starting virtual memory addresses of bytes to set.
+ @prot:  The access type for the tlb lookup
+ @bufs:  array of pointers to variables containing data to be written.
+ @sizes: array of sizes of memory to write to.
+ @errs:  array receiving the result of each write, may be NULL.
+ @count: length of *addrs, *bufs, *sizes and *errs
+
+ See uc_vmem_write() for the translation and uc_mem_write_batch() for the
+ handling of errors.
+
+ @return UC_ERR_OK if all the ranges were written, or the error of the first
+   range which failed (refer to uc_err enum for detailed error).
+*/
+UNICORN_EXPORT
+uc_err uc_vmem_write_batch(uc_engine *uc, const uint64_t *addrs, uc_prot prot,
+                           const void *const *bufs, const size_t *sizes,
+                           uc_err *errs, int count);
+
 /*
  Emulate machine code in a specific duration of time.
 
@@ -1208,6 +1430,42 @@ uc_err uc_mmio_map(uc_engine *uc, uint64_t address, uint64_t size,
 UNICORN_EXPORT
 uc_err uc_mem_unmap(uc_engine *uc, uint64_t address, uint64_t size);
 
+/*
+ Map several regions of memory at once, see uc_mem_map().
+ All regions are checked first, nothing is mapped if any of them is invalid.
+ The memory layout is rebuilt only once for the whole batch, which keeps
+ mapping thousands of regions (e.g. the segments of an ELF file) linear.
+
+ @uc: handle returned by uc_open()
+ @regions: the regions to map, [begin, end] with the permissions in perms.
+    These must not overlap each other or memory already mapped.
+ @count: number of entries in @regions
+
+ @return UC_ERR_OK on success, or other value on failure (refer to uc_err enum
+   for detailed error).
+*/
+UNICORN_EXPORT
+uc_err uc_mem_map_batch(uc_engine *uc, const uc_mem_region *regions,
+                        uint32_t count);
+
+/*
+ Unmap several regions of memory at once, see uc_mem_unmap().
+ All regions are checked first, nothing is unmapped if any of them is
+ invalid. Regions made of whole mappings are removed together with a single
+ rebuild of the memory layout.
+
+ @uc: handle returned by uc_open()
+ @regions: the regions to unmap, [begin, end]; perms is ignored.
+    These must not overlap each other.
+ @count: number of entries in @regions
+
+ @return UC_ERR_OK on success, or other value on failure (refer to uc_err enum
+   for detailed error).
+*/
+UNICORN_EXPORT
+uc_err uc_mem_unmap_batch(uc_engine *uc, const uc_mem_region *regions,
+                          uint32_t count);
+
 /*
  Set memory permissions for emulation memory.
  This API changes permissions on an existing memory region.
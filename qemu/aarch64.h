@@ -127,10 +127,16 @@
 #define memory_map_io memory_map_io_aarch64
 #define memory_map_ptr memory_map_ptr_aarch64
 #define memory_cow memory_cow_aarch64
+#define memory_page_saved memory_page_saved_aarch64
+#define memory_restore_pages memory_restore_pages_aarch64
 #define memory_unmap memory_unmap_aarch64
 #define memory_moveout memory_moveout_aarch64
 #define memory_movein memory_movein_aarch64
 #define memory_free memory_free_aarch64
+#define memory_reset memory_reset_aarch64
+#define memory_unmap_batch memory_unmap_batch_aarch64
+#define memory_transaction_begin memory_transaction_begin_aarch64
+#define memory_transaction_commit memory_transaction_commit_aarch64
 #define flatview_unref flatview_unref_aarch64
 #define address_space_get_flatview address_space_get_flatview_aarch64
 #define memory_region_transaction_begin memory_region_transaction_begin_aarch64
@@ -1273,6 +1279,15 @@
 #define tb_check_watchpoint tb_check_watchpoint_aarch64
 #define cpu_io_recompile cpu_io_recompile_aarch64
 #define tb_flush_jmp_cache tb_flush_jmp_cache_aarch64
+#define tb_flush_cross_page_jumps tb_flush_cross_page_jumps_aarch64
+#define tb_ic_flush tb_ic_flush_aarch64
+#define tb_gen_superblock tb_gen_superblock_aarch64
+#define translator_follow_jump translator_follow_jump_aarch64
+#define translator_follow_branch translator_follow_branch_aarch64
+#define tcg_gen_lookup_and_goto_ptr_ic tcg_gen_lookup_and_goto_ptr_ic_aarch64
+#define tcg_gen_lookup_and_goto_ptr_ret tcg_gen_lookup_and_goto_ptr_ret_aarch64
+#define tcg_gen_push_return tcg_gen_push_return_aarch64
+#define helper_lookup_tb_ptr_ic helper_lookup_tb_ptr_ic_aarch64
 #define tcg_flush_softmmu_tlb tcg_flush_softmmu_tlb_aarch64
 #define translator_loop_temp_check translator_loop_temp_check_aarch64
 #define translator_loop translator_loop_aarch64
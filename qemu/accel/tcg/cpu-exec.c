@@ -257,6 +257,16 @@ static inline TranslationBlock *tb_find(CPUState *cpu,
     struct hook *hook;
 
     tb = tb_lookup__cpu_state(cpu, &pc, &cs_base, &flags, cf_mask);
+    if (tb && unlikely(uc->tb_superblock_threshold) &&
+        !(tb->cflags & CF_SUPERBLOCK) &&
+        uc->tcg_ctx->tb_ctx.exec_count[tb_exec_count_hash_func(uc, pc)] ==
+            uc->tb_superblock_threshold) {
+        /* Unicorn: the TB got hot and left early, see gen_tb_exec_count() */
+        mmap_lock();
+        tb = tb_gen_superblock(cpu, tb, cf_mask);
+        mmap_unlock();
+        cpu->tb_jmp_cache[tb_jmp_cache_hash_func(cpu->uc, pc)] = tb;
+    }
     if (tb == NULL) {
         mmap_lock();
         tb = tb_gen_code(cpu, pc, cs_base, flags, cf_mask);
@@ -279,15 +289,15 @@ static inline TranslationBlock *tb_find(CPUState *cpu,
             }
         }
     }
-    /* We don't take care of direct jumps when address mapping changes in
-     * system emulation. So it's not safe to make a direct jump to a TB
-     * spanning two pages because the mapping for the second page can change.
-     */
-    if (tb->page_addr[1] != -1) {
-        last_tb = NULL;
-    }
     /* See if we can patch the calling TB. */
     if (last_tb) {
+        /* Unicorn: the mapping of the second page of a TB can change, the
+         * jumps into it are removed again when its TLB entry is flushed.
+         */
+        if (tb->page_addr[1] != -1 && !tb->cross_page_link.le_prev) {
+            QLIST_INSERT_HEAD(&cpu->uc->tcg_ctx->tb_ctx.cross_page_tbs, tb,
+                              cross_page_link);
+        }
         tb_exec_unlock(cpu->uc);
         tb_add_jump(last_tb, tb_exit, tb);
         tb_exec_lock(cpu->uc);
@@ -68,6 +68,16 @@ QEMU_BUILD_BUG_ON(sizeof(target_ulong) > sizeof(run_on_cpu_data));
 /* We currently can't handle more than 16 bits in the MMUIDX bitmask.
  */
 QEMU_BUILD_BUG_ON(NB_MMU_MODES > 16);
+/*
+ * The TLB flags share the comparator with the alignment bits of the
+ * access (see tcg_out_tlb_load), so they must stay clear of the largest
+ * alignment the target asks for.
+ */
+#ifdef TARGET_SPARC
+QEMU_BUILD_BUG_ON(TLB_FLAGS_MASK & ((1 << (MO_ALIGN_64 >> MO_ASHIFT)) - 1));
+#else
+QEMU_BUILD_BUG_ON(TLB_FLAGS_MASK & ((1 << (MO_ALIGN_16 >> MO_ASHIFT)) - 1));
+#endif
 #define ALL_MMUIDX_BITS ((1 << NB_MMU_MODES) - 1)
 
 static inline size_t tlb_n_entries(CPUTLBDescFast *fast)
@@ -301,6 +311,8 @@ static void tlb_flush_by_mmuidx_async_work(CPUState *cpu, run_on_cpu_data data)
     }
 
     cpu_tb_jmp_cache_clear(cpu);
+    tb_flush_cross_page_jumps(cpu);
+    tb_ic_flush(cpu->uc->tcg_ctx);
 
     if (to_clean == ALL_MMUIDX_BITS) {
         env_tlb(env)->c.full_flush_count = env_tlb(env)->c.full_flush_count + 1;
@@ -404,6 +416,7 @@ static void tlb_flush_page_locked(CPUArchState *env, int midx,
     /* Check if we need to flush due to large pages.  */
     if ((page & lp_mask) == lp_addr) {
         tlb_flush_one_mmuidx_locked(env, midx, get_clock_realtime());
+        tb_flush_cross_page_jumps(env_cpu(env));
     } else {
         if (tlb_flush_entry_locked(env->uc, tlb_entry(env, midx, page), page)) {
             tlb_n_used_entries_dec(env, midx);
@@ -872,7 +885,9 @@ void tlb_set_page_with_attrs(CPUState *cpu, target_ulong vaddr,
          * the page is actually writable.
          */
         if (prot & PAGE_WRITE) {
-            if (section->readonly) {
+            /* Unicorn: pages write protected inside a writable region too */
+            if (section->readonly ||
+                !(uc_mem_perms(section->mr, paddr_page) & UC_PROT_WRITE)) {
                 write_address |= TLB_DISCARD_WRITE;
             } else if (cpu_physical_memory_is_clean(iotlb)) {
                 write_address |= TLB_NOTDIRTY;
@@ -963,6 +978,19 @@ void tlb_set_page_with_attrs(CPUState *cpu, target_ulong vaddr,
         }
     }
 
+    /*
+     * Unicorn: only pages covered by a memory hook have to go through
+     * load_helper/store_helper, all others keep the inline fast path.
+     */
+    if (tn.addr_read != -1 &&
+        uc_mem_read_hook_installed_page(cpu->uc, paddr_page, TARGET_PAGE_SIZE)) {
+        tn.addr_read |= TLB_UC_HOOK;
+    }
+    if (tn.addr_write != -1 &&
+        uc_mem_write_hook_installed_page(cpu->uc, paddr_page, TARGET_PAGE_SIZE)) {
+        tn.addr_write |= TLB_UC_HOOK;
+    }
+
     copy_tlb_helper_locked(te, &tn);
     tlb_n_used_entries_inc(env, mmu_idx);
 }
@@ -1194,7 +1222,9 @@ static void notdirty_write(CPUState *cpu, vaddr mem_vaddr, unsigned size,
     struct uc_struct *uc = cpu->uc;
 #endif
     ram_addr_t ram_addr = mem_vaddr + iotlbentry->addr;
-    MemoryRegion *mr = cpu->uc->memory_mapping(cpu->uc, tlbe->paddr | (mem_vaddr & ~TARGET_PAGE_MASK));
+    hwaddr paddr = tlbe->paddr | (mem_vaddr & ~TARGET_PAGE_MASK);
+    MemoryRegion *mr = cpu->uc->memory_mapping(cpu->uc, paddr);
+    bool snapshot;
 
     if (mr && (mr->perms & UC_PROT_EXEC) != 0) {
         struct page_collection *pages
@@ -1206,11 +1236,16 @@ static void notdirty_write(CPUState *cpu, vaddr mem_vaddr, unsigned size,
     /* For exec pages, this is cleared in tb_gen_code. */
     // If we:
     // - have memory hooks installed
-    // - or doing snapshot
+    // - or doing snapshot and the page is not saved yet
     // , then never clean the tlb
-    if (!(!mr || (tlbe->addr_write != -1 && mr->priority < cpu->uc->snapshot_level)) &&
+    snapshot = mr && tlbe->addr_write != -1 &&
+               mr->priority < cpu->uc->snapshot_level;
+    if (snapshot && cpu->uc->snapshot_type == UC_SNAPSHOT_PAGE) {
+        snapshot = !memory_page_saved(cpu->uc, mr, paddr & TARGET_PAGE_MASK);
+    }
+    if (!(!mr || snapshot) &&
             !(tlbe->addr_code != -1) &&
-            !uc_mem_hook_installed(cpu->uc, tlbe->paddr | (mem_vaddr & ~TARGET_PAGE_MASK))) {
+            !uc_mem_hook_installed(cpu->uc, paddr)) {
         tlb_set_dirty(cpu, mem_vaddr);
     }
 }
@@ -1449,7 +1484,8 @@ static void *atomic_mmu_lookup(CPUArchState *env, target_ulong addr,
     }
 
     /* Let the guest notice RMW on a write-only page.  */
-    if (unlikely(tlbe->addr_read != (tlb_addr & ~TLB_NOTDIRTY))) {
+    if (unlikely((tlbe->addr_read & ~TLB_UC_HOOK) !=
+                 (tlb_addr & ~(TLB_NOTDIRTY | TLB_UC_HOOK)))) {
         tlb_fill(env_cpu(env), addr, 1 << s_bits, MMU_DATA_LOAD,
                  mmu_idx, retaddr);
         /* Since we don't support reads and writes to different addresses,
@@ -1528,7 +1564,7 @@ load_helper(CPUArchState *env, target_ulong addr, TCGMemOpIdx oi,
     int error_code;
     struct hook *hook;
     bool handled;
-    HOOK_FOREACH_VAR_DECLARE;
+    HOOK_FOREACH_BOUNDED_VAR_DECLARE;
     struct uc_struct *uc = env->uc;
     MemoryRegion *mr;
     bool synced = false;
@@ -1563,7 +1599,7 @@ load_helper(CPUArchState *env, target_ulong addr, TCGMemOpIdx oi,
             if (code_read) {
                 // code fetching  
                 error_code = UC_ERR_FETCH_UNMAPPED;
-                HOOK_FOREACH(uc, hook, UC_HOOK_MEM_FETCH_UNMAPPED) {
+                HOOK_FOREACH_BOUNDED(uc, hook, UC_HOOK_MEM_FETCH_UNMAPPED, paddr) {
                     if (hook->to_delete)
                         continue;
                     if (!HOOK_BOUND_CHECK(hook, paddr))
@@ -1584,7 +1620,7 @@ load_helper(CPUArchState *env, target_ulong addr, TCGMemOpIdx oi,
             } else {
                 // data reading
                 error_code = UC_ERR_READ_UNMAPPED;
-                HOOK_FOREACH(uc, hook, UC_HOOK_MEM_READ_UNMAPPED) {
+                HOOK_FOREACH_BOUNDED(uc, hook, UC_HOOK_MEM_READ_UNMAPPED, paddr) {
                     if (hook->to_delete)
                         continue;
                     if (!HOOK_BOUND_CHECK(hook, paddr))
@@ -1652,7 +1688,7 @@ load_helper(CPUArchState *env, target_ulong addr, TCGMemOpIdx oi,
     // patch issue #1041 multiple UC_HOOK_MEM callbacks for unaligned access
     if (!code_read && !uc->size_recur_mem) {
         // this is date reading
-        HOOK_FOREACH(uc, hook, UC_HOOK_MEM_READ) {
+        HOOK_FOREACH_BOUNDED(uc, hook, UC_HOOK_MEM_READ, paddr) {
             if (hook->to_delete)
                 continue;
             if (!HOOK_BOUND_CHECK(hook, paddr))
@@ -1682,9 +1718,9 @@ load_helper(CPUArchState *env, target_ulong addr, TCGMemOpIdx oi,
         }
 
         // callback on non-readable memory
-        if (mr != NULL && !(mr->perms & UC_PROT_READ)) {  //non-readable
+        if (mr != NULL && !(uc_mem_perms(mr, paddr) & UC_PROT_READ)) {  //non-readable
             handled = false;
-            HOOK_FOREACH(uc, hook, UC_HOOK_MEM_READ_PROT) {
+            HOOK_FOREACH_BOUNDED(uc, hook, UC_HOOK_MEM_READ_PROT, paddr) {
                 if (hook->to_delete)
                     continue;
                 if (!HOOK_BOUND_CHECK(hook, paddr))
@@ -1732,9 +1768,9 @@ load_helper(CPUArchState *env, target_ulong addr, TCGMemOpIdx oi,
     } else if (code_read) {
         // code fetching
         // Unicorn: callback on fetch from NX
-        if (mr != NULL && !(mr->perms & UC_PROT_EXEC)) {  // non-executable
+        if (mr != NULL && !(uc_mem_perms(mr, paddr) & UC_PROT_EXEC)) {  // non-executable
             handled = false;
-            HOOK_FOREACH(uc, hook, UC_HOOK_MEM_FETCH_PROT) {
+            HOOK_FOREACH_BOUNDED(uc, hook, UC_HOOK_MEM_FETCH_PROT, paddr) {
                 if (hook->to_delete)
                     continue;
                 if (!HOOK_BOUND_CHECK(hook, paddr))
@@ -1848,7 +1884,7 @@ _out:
     // Unicorn: callback on successful data read
     if (!code_read) {
         if (!uc->size_recur_mem) { // disabling read callback if in recursive call
-            HOOK_FOREACH(uc, hook, UC_HOOK_MEM_READ_AFTER) {
+            HOOK_FOREACH_BOUNDED(uc, hook, UC_HOOK_MEM_READ_AFTER, paddr) {
                 if (hook->to_delete)
                     continue;
                 if (!HOOK_BOUND_CHECK(hook, paddr))
@@ -2157,7 +2193,7 @@ store_helper(CPUArchState *env, target_ulong addr, uint64_t val,
              TCGMemOpIdx oi, uintptr_t retaddr, MemOp op)
 {
     struct uc_struct *uc = env->uc;
-    HOOK_FOREACH_VAR_DECLARE;
+    HOOK_FOREACH_BOUNDED_VAR_DECLARE;
     uintptr_t mmu_idx = get_mmuidx(oi);
     uintptr_t index = tlb_index(env, mmu_idx, addr);
     CPUTLBEntry *entry = tlb_entry(env, mmu_idx, addr);
@@ -2196,7 +2232,7 @@ store_helper(CPUArchState *env, target_ulong addr, uint64_t val,
 
     if (!uc->size_recur_mem) { // disabling write callback if in recursive call
         // Unicorn: callback on memory write
-        HOOK_FOREACH(uc, hook, UC_HOOK_MEM_WRITE) {
+        HOOK_FOREACH_BOUNDED(uc, hook, UC_HOOK_MEM_WRITE, paddr) {
             if (hook->to_delete)
                 continue;
             if (!HOOK_BOUND_CHECK(hook, paddr))
@@ -2215,7 +2251,7 @@ store_helper(CPUArchState *env, target_ulong addr, uint64_t val,
     // Unicorn: callback on invalid memory
     if (mr == NULL) {
         handled = false;
-        HOOK_FOREACH(uc, hook, UC_HOOK_MEM_WRITE_UNMAPPED) {
+        HOOK_FOREACH_BOUNDED(uc, hook, UC_HOOK_MEM_WRITE_UNMAPPED, paddr) {
             if (hook->to_delete)
                 continue;
             if (!HOOK_BOUND_CHECK(hook, paddr))
@@ -2265,10 +2301,10 @@ store_helper(CPUArchState *env, target_ulong addr, uint64_t val,
     }
 
     // Unicorn: callback on non-writable memory
-    if (mr != NULL && !(mr->perms & UC_PROT_WRITE)) {  //non-writable
+    if (mr != NULL && !(uc_mem_perms(mr, paddr) & UC_PROT_WRITE)) {  //non-writable
         // printf("not writable memory???\n");
         handled = false;
-        HOOK_FOREACH(uc, hook, UC_HOOK_MEM_WRITE_PROT) {
+        HOOK_FOREACH_BOUNDED(uc, hook, UC_HOOK_MEM_WRITE_PROT, paddr) {
             if (hook->to_delete)
                 continue;
             if (!HOOK_BOUND_CHECK(hook, paddr))
@@ -2310,19 +2346,22 @@ store_helper(CPUArchState *env, target_ulong addr, uint64_t val,
     }
 
     if (uc->snapshot_level && mr->ram && mr->priority < uc->snapshot_level) {
-        mr = memory_cow(uc, mr, paddr & TARGET_PAGE_MASK, TARGET_PAGE_SIZE);
-        if (!mr) {
+        MemoryRegion *cow = memory_cow(uc, mr, paddr & TARGET_PAGE_MASK, TARGET_PAGE_SIZE);
+        if (!cow) {
             uc->invalid_addr = paddr;
             uc->invalid_error = UC_ERR_NOMEM;
             cpu_exit(uc->cpu);
             return;
         }
-        /* refill tlb after CoW */
-        tlb_fill(env_cpu(env), addr, size, MMU_DATA_STORE,
-                 mmu_idx, retaddr);
-        index = tlb_index(env, mmu_idx, addr);
-        entry = tlb_entry(env, mmu_idx, addr);
-        tlb_addr = tlb_addr_write(entry);
+        /* refill tlb after CoW, the page snapshot backend writes in place */
+        if (cow != mr) {
+            tlb_fill(env_cpu(env), addr, size, MMU_DATA_STORE,
+                     mmu_idx, retaddr);
+            index = tlb_index(env, mmu_idx, addr);
+            entry = tlb_entry(env, mmu_idx, addr);
+            tlb_addr = tlb_addr_write(entry);
+        }
+        mr = cow;
     }
 
     /* Handle anything that isn't just a straight memory access.  */
@@ -28,6 +28,7 @@
 #include "exec/cpu_ldst.h"
 #include "exec/exec-all.h"
 #include "exec/tb-lookup.h"
+#include "qemu/timer.h"
 #include "tcg/tcg.h"
 
 #include <uc_priv.h>
@@ -160,14 +161,102 @@ void *HELPER(lookup_tb_ptr)(CPUArchState *env)
     return tb->tc.ptr;
 }
 
+/*
+ * Unicorn: the slow path of tcg_gen_lookup_and_goto_ptr_ic(). Besides looking
+ * up the TB, this refills the inline cache @ic of the jump, if any, and the
+ * return address cache @ret popped from the shadow stack if the jump returns
+ * to its call site. @pc is the key the generated code compared, e.g. ARM
+ * includes the Thumb bit.
+ */
+void *HELPER(lookup_tb_ptr_ic)(CPUArchState *env, void *ic, void *ret,
+                               uint64_t pc)
+{
+    CPUState *cpu = env_cpu(env);
+    TranslationBlock *tb;
+    target_ulong cs_base, tb_pc;
+    uint32_t flags;
+    struct uc_struct *uc = (struct uc_struct *)cpu->uc;
+    TBContext *tb_ctx = &uc->tcg_ctx->tb_ctx;
+    TBInlineCache entry;
+
+    tb = tb_lookup__cpu_state(cpu, &tb_pc, &cs_base, &flags, curr_cflags());
+    if (tb == NULL) {
+        return uc->tcg_ctx->code_gen_epilogue;
+    }
+
+    entry.pc = pc;
+    entry.ptr = tb->tc.ptr;
+    entry.gen = tb_ctx->ic_gen;
+    /* the caches live in the TBs, which share the buffer of generated code */
+    tb_exec_unlock(uc);
+    if (ic) {
+        TBInlineCache *ways = ic;
+        int i;
+
+        /* keep the most recent destination first */
+        for (i = TB_IC_WAYS - 1; i > 0; i--) {
+            ways[i] = ways[i - 1];
+        }
+        ways[0] = entry;
+    }
+    if (ret && ret != &tb_ctx->ret_empty &&
+        ((TBInlineCache *)ret)->pc == pc) {
+        *(TBInlineCache *)ret = entry;
+    }
+    tb_exec_lock(uc);
+    return tb->tc.ptr;
+}
+
 void HELPER(exit_atomic)(CPUArchState *env)
 {
     cpu_loop_exit_atomic(env_cpu(env), GETPC());
 }
 
-void HELPER(check_exit_request)(void *p, uint32_t in_delay_slot) {
+// Unicorn: reading the clock costs about as much as a short TB, so the
+// uc_emu_start() deadline is only checked every UC_TIMEOUT_POLL_TBS blocks.
+#define UC_TIMEOUT_POLL_TBS 64
+
+void HELPER(check_exit_request)(void *p, uint32_t in_delay_slot,
+                                uint32_t icount) {
     uc_engine *uc = p;
 
+    // Charge the TB against the instruction budget of uc_emu_start(). If
+    // the budget doesn't cover the whole TB, quit before its first
+    // instruction and either stop or retranslate it with just the
+    // remaining instructions.
+    if (icount && unlikely(uc->emu_count)) {
+        size_t left = uc->emu_counter < uc->emu_count
+                          ? uc->emu_count - uc->emu_counter
+                          : 0;
+
+        if (left >= icount || in_delay_slot) {
+            uc->emu_counter += icount;
+        } else {
+            if (left) {
+                uc->cpu->cflags_next_tb = curr_cflags() | left;
+            } else {
+                uc_emu_stop(uc);
+            }
+
+            if (uc->nested_level == 1) {
+                tb_exec_unlock(uc);
+            }
+            uc->cpu->tcg_exit_req = 0;
+            // Nothing was charged, so there is nothing to give back.
+            cpu_restore_state(uc->cpu, GETPC(), false);
+            cpu_loop_exit(uc->cpu);
+        }
+    }
+
+    if (unlikely(uc->timeout_deadline) && --uc->timeout_poll == 0) {
+        uc->timeout_poll = UC_TIMEOUT_POLL_TBS;
+        if (get_clock() >= uc->timeout_deadline && !uc->stop_request) {
+            uc->timed_out = true;
+            // force emulation to stop
+            uc_emu_stop(uc);
+        }
+    }
+
     if (cpu_loop_exit_requested(uc->cpu) && !in_delay_slot) {
         // There are stil something we have to before exiting to be compatible with previous behaviors
 
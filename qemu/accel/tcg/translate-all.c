@@ -312,6 +312,11 @@ static int cpu_restore_state_from_tb(CPUState *cpu, TranslationBlock *tb,
            and shift if to the number of actually executed instructions */
         cpu_neg(cpu)->icount_decr.u16.low += num_insns - i;
     }
+    if (reset_icount && cpu->uc->emu_count) {
+        /* Unicorn: the TB prologue charged all of its instructions against
+           the uc_emu_start() budget, give back the ones after this one */
+        cpu->uc->emu_counter -= num_insns - i - 1;
+    }
     restore_state_to_opc(env, tb, data);
 
     return 0;
@@ -1100,11 +1105,25 @@ static bool tb_cmp(struct uc_struct *uc, const void *ap, const void *bp)
         a->page_addr[1] == b->page_addr[1];
 }
 
+static void tb_ret_stack_reset(TBContext *tb_ctx)
+{
+    int i;
+
+    memset(&tb_ctx->ret_empty, 0, sizeof(tb_ctx->ret_empty));
+    for (i = 0; i < TB_RET_STACK_SIZE; i++) {
+        tb_ctx->ret_stack[i] = &tb_ctx->ret_empty;
+    }
+    tb_ctx->ret_top = 0;
+}
+
 static void tb_htable_init(struct uc_struct *uc)
 {
     unsigned int mode = QHT_MODE_AUTO_RESIZE;
 
     qht_init(&uc->tcg_ctx->tb_ctx.htable, tb_cmp, CODE_GEN_HTABLE_SIZE, mode);
+    QLIST_INIT(&uc->tcg_ctx->tb_ctx.cross_page_tbs);
+    tb_ret_stack_reset(&uc->tcg_ctx->tb_ctx);
+    uc->tcg_ctx->tb_ctx.ic_gen = 1;
 }
 
 
@@ -1203,6 +1222,149 @@ static uc_err uc_gen_tb(struct uc_struct *uc, uint64_t addr, uc_tb *out_tb)
     return UC_ERR_OK;
 }
 
+typedef struct uc_tb_batch_item {
+    uint64_t pc;
+    uint32_t level;
+} uc_tb_batch_item;
+
+static uc_err uc_gen_tb_batch(struct uc_struct *uc, const uint64_t *addrs,
+                              size_t count, uint32_t depth, size_t budget,
+                              size_t *generated, size_t *used)
+{
+    TCGContext *tcg_ctx = uc->tcg_ctx;
+    CPUState *cpu = uc->cpu;
+    CPUArchState *env = (CPUArchState *)cpu->env_ptr;
+    int exception_index = cpu->exception_index;
+    GArray *work;
+    uc_tb_batch_item item;
+    /* Live across the sigsetjmp() below. */
+    volatile size_t next = 0, ngen = 0, nused = 0;
+    TranslationBlock *tb;
+    target_ulong cs_base, pc;
+    uint32_t flags, cflags;
+    void *code_start;
+    size_t i;
+    int n;
+
+    work = g_array_sized_new(false, false, sizeof(uc_tb_batch_item), count);
+    for (i = 0; i < count; i++) {
+        item.pc = addrs[i];
+        item.level = 0;
+        g_array_append_val(work, item);
+    }
+
+    // One landing pad for the whole batch, a fault while fetching the guest
+    // code only drops the address being translated.
+    uc->nested_level++;
+    if (sigsetjmp(uc->jmp_bufs[uc->nested_level - 1], 0) != 0) {
+        next++;
+        // a full code buffer was flushed, everything generated so far is gone
+        if (cpu->exception_index == EXCP_INTERRUPT) {
+            next = work->len;
+        }
+    }
+
+    while (next < work->len && (budget == 0 || nused < budget)) {
+        item = g_array_index(work, uc_tb_batch_item, next);
+
+        cflags = curr_cflags();
+        cflags &= ~CF_CLUSTER_MASK;
+        cflags |= ((uint32_t)cpu->cluster_index) << CF_CLUSTER_SHIFT;
+        cpu_get_tb_cpu_state(env, &pc, &cs_base, &flags);
+        pc = item.pc;
+
+        // Already cached blocks and exits are not expanded any further, code
+        // outside of RAM is never cached.
+        if (uc_addr_is_exit(uc, pc) ||
+            tb_htable_lookup(cpu, pc, cs_base, flags, cflags) != NULL ||
+            get_page_addr_code(env, pc) == -1) {
+            next++;
+            continue;
+        }
+
+        code_start = tcg_ctx->code_gen_ptr;
+        mmap_lock();
+        tb = tb_gen_code(cpu, pc, cs_base, flags, cflags);
+        mmap_unlock();
+        ngen++;
+        nused += (char *)tcg_ctx->code_gen_ptr - (char *)code_start;
+
+        if (tb->size != 0 && item.level < depth) {
+            for (n = 0; n < tcg_ctx->tb_nsucc; n++) {
+                uc_tb_batch_item succ = {tcg_ctx->tb_succ[n], item.level + 1};
+                g_array_append_val(work, succ);
+            }
+        }
+        next++;
+    }
+
+    uc->nested_level--;
+    cpu->exception_index = exception_index;
+    g_array_free(work, true);
+
+    if (generated) {
+        *generated = ngen;
+    }
+    if (used) {
+        *used = nused;
+    }
+    return UC_ERR_OK;
+}
+
+struct uc_tb_foreach_data {
+    uc_tb_key_cb_t cb;
+    void *opaque;
+};
+
+static void uc_tb_foreach_iter(struct uc_struct *uc, void *p, uint32_t hash,
+                               void *userp)
+{
+    TranslationBlock *tb = p;
+    struct uc_tb_foreach_data *data = userp;
+    uint32_t cflags = tb_cflags(tb);
+    uc_tb_key key;
+
+    // Exit TBs and TBs cut short by an instruction budget depend on the
+    // emulation they were generated for, not on the guest code.
+    if ((cflags & (CF_INVALID | CF_COUNT_MASK)) || tb->size == 0) {
+        return;
+    }
+
+    key.pc = tb->pc;
+    key.cs_base = tb->cs_base;
+    key.flags = tb->flags;
+    key.cflags = cflags & CF_HASH_MASK;
+    key.size = tb->size;
+    data->cb(uc, &key, data->opaque);
+}
+
+static void uc_tb_foreach(struct uc_struct *uc, uc_tb_key_cb_t cb, void *opaque)
+{
+    struct uc_tb_foreach_data data = {cb, opaque};
+
+    qht_iter(uc, &uc->tcg_ctx->tb_ctx.htable, uc_tb_foreach_iter, &data);
+}
+
+static uc_err uc_gen_tb_key(struct uc_struct *uc, const uc_tb_key *key)
+{
+    TranslationBlock *tb;
+    CPUState *cpu = uc->cpu;
+
+    tb = tb_htable_lookup(cpu, key->pc, key->cs_base, key->flags, key->cflags);
+    if (tb == NULL) {
+        mmap_lock();
+        tb = tb_gen_code(cpu, key->pc, key->cs_base, key->flags, key->cflags);
+        mmap_unlock();
+    }
+
+    // If we still couldn't generate a TB, it must be out of memory.
+    if (tb == NULL) {
+        return UC_ERR_NOMEM;
+    }
+
+    return UC_ERR_OK;
+}
+
 /* Must be called before using the QEMU cpus. 'tb_size' is the size
    (in bytes) allocated to the translation buffer. Zero means default
    size. */
@@ -1227,6 +1389,9 @@ void tcg_exec_init(struct uc_struct *uc, uint32_t tb_size)
     /* Invalidate / Cache TBs */
     uc->uc_invalidate_tb = uc_invalidate_tb;
     uc->uc_gen_tb = uc_gen_tb;
+    uc->uc_gen_tb_batch = uc_gen_tb_batch;
+    uc->uc_tb_foreach = uc_tb_foreach;
+    uc->uc_gen_tb_key = uc_gen_tb_key;
     uc->tb_flush = uc_tb_flush;
 
     /* Inline hooks optimization */
@@ -1372,6 +1537,13 @@ static void do_tb_flush(CPUState *cpu, run_on_cpu_data tb_flush_count)
 #endif
 
     qht_reset_size(cpu->uc, &cpu->uc->tcg_ctx->tb_ctx.htable, CODE_GEN_HTABLE_SIZE);
+    QLIST_INIT(&cpu->uc->tcg_ctx->tb_ctx.cross_page_tbs);
+    /* the shadow stack points into the TBs */
+    tb_ret_stack_reset(&cpu->uc->tcg_ctx->tb_ctx);
+    tb_ic_flush(cpu->uc->tcg_ctx);
+    memset(cpu->uc->tcg_ctx->tb_ctx.exec_count, 0,
+           sizeof(cpu->uc->tcg_ctx->tb_ctx.exec_count));
+    cpu->uc->tb_superblocks = 0;
     page_flush_tb(cpu->uc);
 
     tcg_region_reset_all(cpu->uc->tcg_ctx);
@@ -1534,6 +1706,8 @@ static void do_tb_phys_invalidate(TCGContext *tcg_ctx, TranslationBlock *tb, boo
 
     /* suppress any remaining jumps to this TB */
     tb_jmp_unlink(tb);
+    QLIST_SAFE_REMOVE(tb, cross_page_link);
+    tb_ic_flush(tcg_ctx);
 
     tcg_ctx->tb_phys_invalidate_count = tcg_ctx->tb_phys_invalidate_count + 1;
 
@@ -1749,6 +1923,8 @@ TranslationBlock *tb_gen_code(CPUState *cpu,
     tb->cflags = cflags;
     tb->orig_tb = NULL;
     tb->trace_vcpu_dstate = *cpu->trace_dstate;
+    memset(tb->ic, 0, sizeof(tb->ic));
+    memset(&tb->ret_ic, 0, sizeof(tb->ret_ic));
     tcg_ctx->tb_cflags = cflags;
  tb_overflow:
 
@@ -1822,6 +1998,8 @@ TranslationBlock *tb_gen_code(CPUState *cpu,
     tb->jmp_list_next[1] = (uintptr_t)NULL;
     tb->jmp_dest[0] = (uintptr_t)NULL;
     tb->jmp_dest[1] = (uintptr_t)NULL;
+    tb->cross_page_link.le_next = NULL;
+    tb->cross_page_link.le_prev = NULL;
 
     /* init original jump addresses which have been set during tcg_gen_code() */
     if (tb->jmp_reset_offset[0] != TB_JMP_RESET_OFFSET_INVALID) {
@@ -1861,6 +2039,40 @@ TranslationBlock *tb_gen_code(CPUState *cpu,
     return tb;
 }
 
+/*
+ * Unicorn: retranslate the hot @tb as a superblock, which goes on through
+ * the direct jumps and the more frequent side of the conditional branches
+ * after it, see translator_follow_jump(). The superblock replaces @tb and
+ * the jumps chained to @tb are reset along with it. @tb is kept if hooks
+ * need its boundaries or the instruction budget of uc_emu_start(), which is
+ * charged per TB, is in use.
+ *
+ * Called with mmap_lock held for user mode emulation.
+ */
+TranslationBlock *tb_gen_superblock(CPUState *cpu, TranslationBlock *tb,
+                                    uint32_t cf_mask)
+{
+    struct uc_struct *uc = cpu->uc;
+    TCGContext *tcg_ctx = uc->tcg_ctx;
+    target_ulong pc = tb->pc;
+    target_ulong cs_base = tb->cs_base;
+    uint32_t flags = tb->flags;
+
+    if (uc->emu_count || HOOK_EXISTS_BOUNDED(uc, UC_HOOK_CODE, pc) ||
+        HOOK_EXISTS_BOUNDED(uc, UC_HOOK_BLOCK, pc)) {
+        /*
+         * The count goes on past the threshold, so @tb runs next time rather
+         * than leaving early again.
+         */
+        return tb;
+    }
+
+    tb_phys_invalidate(tcg_ctx, tb, -1);
+    tb = tb_gen_code(cpu, pc, cs_base, flags, cf_mask | CF_SUPERBLOCK);
+    uc->tb_superblocks++;
+    return tb;
+}
+
 /*
  * @p must be non-NULL.
  * user-mode: call with mmap_lock held.
@@ -2153,6 +2365,60 @@ static void tb_jmp_cache_clear_page(CPUState *cpu, target_ulong page_addr)
     }
 }
 
+/*
+ * Unicorn: direct jumps into a TB spanning two pages skip the lookup checking
+ * where its second page is mapped. Unlink them whenever the TLB entry of that
+ * page is flushed, the next jump goes through tb_find() again.
+ */
+static void tb_unlink_cross_page(CPUState *cpu, target_ulong page, bool all)
+{
+#ifdef TARGET_ARM
+    struct uc_struct *uc = cpu->uc;
+#endif
+    TBContext *tb_ctx = &cpu->uc->tcg_ctx->tb_ctx;
+    TranslationBlock *tb, *next;
+
+    QLIST_FOREACH_SAFE(tb, &tb_ctx->cross_page_tbs, cross_page_link, next) {
+        if (all || (tb->pc & TARGET_PAGE_MASK) + TARGET_PAGE_SIZE == page) {
+            tb_jmp_unlink(tb);
+            QLIST_REMOVE(tb, cross_page_link);
+        }
+    }
+}
+
+void tb_flush_cross_page_jumps(CPUState *cpu)
+{
+    tb_unlink_cross_page(cpu, 0, true);
+}
+
+static gboolean tb_ic_reset_iter(gpointer key, gpointer value, gpointer data)
+{
+    TranslationBlock *tb = value;
+
+    memset(tb->ic, 0, sizeof(tb->ic));
+    memset(&tb->ret_ic, 0, sizeof(tb->ret_ic));
+    return false;
+}
+
+/*
+ * Unicorn: drop all inline cache entries. They are keyed on virtual
+ * addresses like tb_jmp_cache, so this goes along with clearing it.
+ */
+void tb_ic_flush(TCGContext *tcg_ctx)
+{
+    TBContext *tb_ctx = &tcg_ctx->tb_ctx;
+
+    if (++tb_ctx->ic_gen == 0) {
+        bool code_gen_locked = tb_exec_is_locked(tcg_ctx->uc);
+
+        /* entries of the first generation would become valid again */
+        tb_exec_unlock(tcg_ctx->uc);
+        tcg_tb_foreach(tcg_ctx, tb_ic_reset_iter, NULL);
+        tb_exec_change(tcg_ctx->uc, code_gen_locked);
+        tb_ctx->ic_gen = 1;
+    }
+}
+
 void tb_flush_jmp_cache(CPUState *cpu, target_ulong addr)
 {
 #ifdef TARGET_ARM
@@ -2163,6 +2429,8 @@ void tb_flush_jmp_cache(CPUState *cpu, target_ulong addr)
        overlap the flushed page.  */
     tb_jmp_cache_clear_page(cpu, addr - TARGET_PAGE_SIZE);
     tb_jmp_cache_clear_page(cpu, addr);
+    tb_unlink_cross_page(cpu, addr & TARGET_PAGE_MASK, false);
+    tb_ic_flush(cpu->uc->tcg_ctx);
 }
 
 /* This is a wrapper for common code that can not use CONFIG_SOFTMMU */
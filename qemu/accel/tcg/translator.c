@@ -14,9 +14,13 @@
 #include "exec/exec-all.h"
 #include "exec/gen-icount.h"
 #include "exec/translator.h"
+#include "exec/tb-hash.h"
 
 #include <uc_priv.h>
 
+/* Unicorn: direct jumps followed at most by a superblock */
+#define TB_SUPERBLOCK_MAX_JUMPS 16
+
 /* Pairs with tcg_clear_temp_count.
    To be called by #TranslatorOps.{translate_insn,tb_stop} if
    (1) the target is sufficiently clean to support reporting,
@@ -32,6 +36,134 @@ void translator_loop_temp_check(DisasContextBase *db)
 #endif
 }
 
+/*
+ * Unicorn: count the executions of the TB for the superblock tier. The one
+ * reaching the threshold leaves before the first instruction, so that
+ * tb_find() retranslates the TB with tb_gen_superblock().
+ */
+static void gen_tb_exec_count(const TranslatorOps *ops, DisasContextBase *db,
+                              CPUState *cpu)
+{
+    struct uc_struct *uc = (struct uc_struct *)cpu->uc;
+    TCGContext *tcg_ctx = uc->tcg_ctx;
+    uint32_t *count = &tcg_ctx->tb_ctx.exec_count[
+        tb_exec_count_hash_func(uc, db->pc_first)];
+    TCGv_ptr pcount;
+    TCGv_i32 tmp;
+    TCGLabel *cold;
+
+    if (!uc->tb_superblock_threshold || uc->coverage_map ||
+        (tb_cflags(db->tb) & (CF_SUPERBLOCK | CF_NOCACHE | CF_COUNT_MASK)) ||
+        HOOK_EXISTS_BOUNDED(uc, UC_HOOK_CODE, db->pc_first) ||
+        HOOK_EXISTS_BOUNDED(uc, UC_HOOK_BLOCK, db->pc_first)) {
+        return;
+    }
+
+    pcount = tcg_const_ptr(tcg_ctx, count);
+    tmp = tcg_temp_new_i32(tcg_ctx);
+    cold = gen_new_label(tcg_ctx);
+    tcg_gen_ld_i32(tcg_ctx, tmp, pcount, 0);
+    tcg_gen_addi_i32(tcg_ctx, tmp, tmp, 1);
+    tcg_gen_st_i32(tcg_ctx, tmp, pcount, 0);
+    tcg_gen_brcondi_i32(tcg_ctx, TCG_COND_NE, tmp,
+                        uc->tb_superblock_threshold, cold);
+    ops->pc_sync(db, cpu);
+    tcg_gen_exit_tb(tcg_ctx, db->tb, TB_EXIT_REQUESTED);
+    gen_set_label(tcg_ctx, cold);
+    tcg_temp_free_i32(tcg_ctx, tmp);
+    tcg_temp_free_ptr(tcg_ctx, pcount);
+}
+
+/*
+ * Unicorn: record the edge from the previous block to this one in the
+ * coverage bitmap, like AFL does:
+ *   map[(prev_loc ^ cur_loc) & mask]++; prev_loc = cur_loc >> 1;
+ * cur_loc is known here, prev_loc lives in the CPUState so that chained TBs
+ * keep the count going without leaving the generated code.
+ */
+static void gen_tb_coverage(DisasContextBase *db, CPUState *cpu)
+{
+    struct uc_struct *uc = (struct uc_struct *)cpu->uc;
+    TCGContext *tcg_ctx = uc->tcg_ctx;
+    uint64_t pc = db->pc_first;
+    uint32_t cur_loc;
+    TCGv_i32 loc, cnt;
+    TCGv_ptr ptr;
+    const int prev_loc_ofs =
+        offsetof(ArchCPU, parent_obj.cov_prev_loc) - offsetof(ArchCPU, env);
+
+    if (!uc->coverage_map) {
+        return;
+    }
+
+    cur_loc = ((pc >> 4) ^ (pc << 8)) & (uc->coverage_size - 1);
+
+    loc = tcg_temp_new_i32(tcg_ctx);
+    cnt = tcg_temp_new_i32(tcg_ctx);
+    ptr = tcg_temp_new_ptr(tcg_ctx);
+    tcg_gen_ld_i32(tcg_ctx, loc, tcg_ctx->cpu_env, prev_loc_ofs);
+    tcg_gen_xori_i32(tcg_ctx, loc, loc, cur_loc);
+    tcg_gen_ext_i32_ptr(tcg_ctx, ptr, loc);
+    tcg_gen_addi_ptr(tcg_ctx, ptr, ptr, (intptr_t)uc->coverage_map);
+    tcg_gen_ld8u_i32(tcg_ctx, cnt, ptr, 0);
+    tcg_gen_addi_i32(tcg_ctx, cnt, cnt, 1);
+    tcg_gen_st8_i32(tcg_ctx, cnt, ptr, 0);
+    tcg_gen_movi_i32(tcg_ctx, loc, cur_loc >> 1);
+    tcg_gen_st_i32(tcg_ctx, loc, tcg_ctx->cpu_env, prev_loc_ofs);
+    tcg_temp_free_ptr(tcg_ctx, ptr);
+    tcg_temp_free_i32(tcg_ctx, cnt);
+    tcg_temp_free_i32(tcg_ctx, loc);
+}
+
+static bool translator_can_follow(struct uc_struct *uc, DisasContextBase *db,
+                                  target_ulong insn_end, target_ulong dest)
+{
+    return (tb_cflags(db->tb) & CF_SUPERBLOCK) &&
+           db->num_jumps < TB_SUPERBLOCK_MAX_JUMPS &&
+           db->num_insns < db->max_insns &&
+           dest >= insn_end &&
+           (dest & TARGET_PAGE_MASK) == (db->pc_first & TARGET_PAGE_MASK) &&
+           !uc_addr_is_exit(uc, dest) &&
+           !HOOK_EXISTS_BOUNDED(uc, UC_HOOK_CODE, dest) &&
+           !HOOK_EXISTS_BOUNDED(uc, UC_HOOK_BLOCK, dest);
+}
+
+bool translator_follow_jump(TCGContext *tcg_ctx, DisasContextBase *db,
+                            target_ulong insn_end, target_ulong dest)
+{
+    if (!translator_can_follow(tcg_ctx->uc, db, insn_end, dest)) {
+        return false;
+    }
+    db->num_jumps++;
+    return true;
+}
+
+int translator_follow_branch(TCGContext *tcg_ctx, DisasContextBase *db,
+                             target_ulong insn_end, target_ulong taken)
+{
+    struct uc_struct *uc = tcg_ctx->uc;
+    uint32_t *exec_count = tcg_ctx->tb_ctx.exec_count;
+    uint32_t taken_count, next_count;
+
+    if (!(tb_cflags(db->tb) & CF_SUPERBLOCK)) {
+        return -1;
+    }
+
+    /* superblocks keep the count that made them hot */
+    taken_count = exec_count[tb_exec_count_hash_func(uc, taken)];
+    next_count = exec_count[tb_exec_count_hash_func(uc, insn_end)];
+    if (taken_count > next_count) {
+        if (translator_follow_jump(tcg_ctx, db, insn_end, taken)) {
+            return 1;
+        }
+    } else if (next_count) {
+        if (translator_follow_jump(tcg_ctx, db, insn_end, insn_end)) {
+            return 0;
+        }
+    }
+    return -1;
+}
+
 void translator_loop(const TranslatorOps *ops, DisasContextBase *db,
                      CPUState *cpu, TranslationBlock *tb, int max_insns)
 {
@@ -49,6 +181,8 @@ void translator_loop(const TranslatorOps *ops, DisasContextBase *db,
     db->num_insns = 0;
     db->max_insns = max_insns;
     db->singlestep_enabled = cpu->singlestep_enabled;
+    db->num_jumps = 0;
+    tcg_ctx->tb_nsucc = 0;
 
     ops->init_disas_context(db, cpu);
     tcg_debug_assert(db->is_jmp == DISAS_NEXT);  /* no early exit */
@@ -69,22 +203,30 @@ void translator_loop(const TranslatorOps *ops, DisasContextBase *db,
         goto _end_loop;
     }
 
+    /* Start translating.  */
+    gen_tb_exec_count(ops, db, cpu);
+    gen_tb_start(tcg_ctx, db->tb);
+    // tcg_dump_ops(tcg_ctx, false, "tb start");
+
     /* Unicorn: trace this block on request
      * Only hook this block if it is not broken from previous translation due to
      * full translation cache
+     * The hook comes after the prologue so that a block cut short by the
+     * instruction budget isn't reported twice, and is followed by its own
+     * exit check so that uc_emu_stop() in the callback still takes effect
+     * before the first instruction.
      */
     if (HOOK_EXISTS_BOUNDED(uc, UC_HOOK_BLOCK, tb->pc)) {
         ops->pc_sync(db, cpu);
         prev_op = tcg_last_op(tcg_ctx);
         block_hook = true;
         gen_uc_tracecode(tcg_ctx, 0xf8f8f8f8, UC_HOOK_BLOCK_IDX, uc, db->pc_first);
+        gen_tb_check_exit_request(tcg_ctx, 0);
     }
 
-    // tcg_dump_ops(tcg_ctx, false, "translator loop");
+    gen_tb_coverage(db, cpu);
 
-    /* Start translating.  */
-    gen_tb_start(tcg_ctx, db->tb);
-    // tcg_dump_ops(tcg_ctx, false, "tb start");
+    // tcg_dump_ops(tcg_ctx, false, "translator loop");
 
     ops->tb_start(db, cpu);
     // tcg_dump_ops(tcg_ctx, false, "tb start 2");
@@ -127,10 +127,16 @@
 #define memory_map_io memory_map_io_arm
 #define memory_map_ptr memory_map_ptr_arm
 #define memory_cow memory_cow_arm
+#define memory_page_saved memory_page_saved_arm
+#define memory_restore_pages memory_restore_pages_arm
 #define memory_unmap memory_unmap_arm
 #define memory_moveout memory_moveout_arm
 #define memory_movein memory_movein_arm
 #define memory_free memory_free_arm
+#define memory_reset memory_reset_arm
+#define memory_unmap_batch memory_unmap_batch_arm
+#define memory_transaction_begin memory_transaction_begin_arm
+#define memory_transaction_commit memory_transaction_commit_arm
 #define flatview_unref flatview_unref_arm
 #define address_space_get_flatview address_space_get_flatview_arm
 #define memory_region_transaction_begin memory_region_transaction_begin_arm
@@ -1273,6 +1279,15 @@
 #define tb_check_watchpoint tb_check_watchpoint_arm
 #define cpu_io_recompile cpu_io_recompile_arm
 #define tb_flush_jmp_cache tb_flush_jmp_cache_arm
+#define tb_flush_cross_page_jumps tb_flush_cross_page_jumps_arm
+#define tb_ic_flush tb_ic_flush_arm
+#define tb_gen_superblock tb_gen_superblock_arm
+#define translator_follow_jump translator_follow_jump_arm
+#define translator_follow_branch translator_follow_branch_arm
+#define tcg_gen_lookup_and_goto_ptr_ic tcg_gen_lookup_and_goto_ptr_ic_arm
+#define tcg_gen_lookup_and_goto_ptr_ret tcg_gen_lookup_and_goto_ptr_ret_arm
+#define tcg_gen_push_return tcg_gen_push_return_arm
+#define helper_lookup_tb_ptr_ic helper_lookup_tb_ptr_ic_arm
 #define tcg_flush_softmmu_tlb tcg_flush_softmmu_tlb_arm
 #define translator_loop_temp_check translator_loop_temp_check_arm
 #define translator_loop translator_loop_arm
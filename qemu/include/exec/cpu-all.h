@@ -333,6 +333,10 @@ CPUArchState *cpu_copy(CPUArchState *env);
 #define TLB_MMIO            (1 << (TARGET_PAGE_BITS_MIN - 3))
 /* Set if TLB entry contains a watchpoint.  */
 #define TLB_WATCHPOINT      (1 << (TARGET_PAGE_BITS_MIN - 4))
+/* Unicorn: Set if the page is covered by a memory hook.  Unicorn has no
+   watchpoints, so the watchpoint bit is reused: there is no room for
+   another flag above the 16-byte alignment mask with 1k pages (ARM).  */
+#define TLB_UC_HOOK         TLB_WATCHPOINT
 /* Set if TLB entry requires byte swap.  */
 #define TLB_BSWAP           (1 << (TARGET_PAGE_BITS_MIN - 5))
 /* Set if TLB entry writes ignored.  */
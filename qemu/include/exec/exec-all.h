@@ -61,6 +61,8 @@ TranslationBlock *tb_gen_code(CPUState *cpu,
                               target_ulong pc, target_ulong cs_base,
                               uint32_t flags,
                               int cflags);
+TranslationBlock *tb_gen_superblock(CPUState *cpu, TranslationBlock *tb,
+                                    uint32_t cf_mask);
 
 void QEMU_NORETURN cpu_loop_exit(CPUState *cpu);
 void QEMU_NORETURN cpu_loop_exit_restore(CPUState *cpu, uintptr_t pc);
@@ -313,6 +315,7 @@ struct TranslationBlock {
 #define CF_USE_ICOUNT  0x00020000
 #define CF_INVALID     0x00040000 /* TB is stale. Set with @jmp_lock held */
 #define CF_PARALLEL    0x00080000 /* Generate code for a parallel context */
+#define CF_SUPERBLOCK  0x00100000 /* Unicorn: hot path across TBs */
 #define CF_CLUSTER_MASK 0xff000000 /* Top 8 bits are cluster ID */
 #define CF_CLUSTER_SHIFT 24
 /* cflags' mask for hashing/comparison */
@@ -364,6 +367,19 @@ struct TranslationBlock {
     uintptr_t jmp_list_next[2];
     uintptr_t jmp_dest[2];
     uint32_t hash;  // unicorn needs this hash to remove this TB from QHT cache
+
+    /*
+     * Unicorn: a TB spanning two pages is linked in tb_ctx.cross_page_tbs
+     * while other TBs jump to it directly, see tb_flush_cross_page_jumps().
+     */
+    QLIST_ENTRY(TranslationBlock) cross_page_link;
+
+    /*
+     * Unicorn: inline caches of the indirect jump ending this TB and of the
+     * return address of the call ending it.
+     */
+    TBInlineCache ic[TB_IC_WAYS];
+    TBInlineCache ret_ic;
 };
 
 // extern bool parallel_cpus;
@@ -469,6 +485,8 @@ void tlb_set_dirty(CPUState *cpu, target_ulong vaddr);
 
 /* exec.c */
 void tb_flush_jmp_cache(CPUState *cpu, target_ulong addr);
+void tb_flush_cross_page_jumps(CPUState *cpu);
+void tb_ic_flush(TCGContext *tcg_ctx);
 
 MemoryRegionSection *
 address_space_translate_for_iotlb(CPUState *cpu, int asidx, hwaddr addr,
@@ -500,4 +518,39 @@ static inline bool uc_mem_hook_installed(struct uc_struct *uc, hwaddr paddr)
     return false;
 }
 
+// Permissions of the page at paddr, mr being the region mapped there.
+static inline uint32_t uc_mem_perms(MemoryRegion *mr, hwaddr paddr)
+{
+    struct uc_struct *uc = mr->uc;
+    MemoryRegion *container;
+
+    if (likely(!mr->page_perms)) {
+        return mr->perms;
+    }
+    paddr -= mr->addr;
+    for (container = mr->container; container != uc->system_memory;
+         container = container->container) {
+        paddr -= container->addr;
+    }
+    return mr->page_perms[paddr >> TARGET_PAGE_BITS];
+}
+
+// Whether any read hook may fire on the page [paddr, paddr + len).
+static inline bool uc_mem_read_hook_installed_page(struct uc_struct *uc,
+                                                   hwaddr paddr, hwaddr len)
+{
+    if (HOOK_EXISTS_OVERLAP(uc, UC_HOOK_MEM_READ, paddr, paddr + len - 1))
+        return true;
+    if (HOOK_EXISTS_OVERLAP(uc, UC_HOOK_MEM_READ_AFTER, paddr, paddr + len - 1))
+        return true;
+    return false;
+}
+
+// Whether any write hook may fire on the page [paddr, paddr + len).
+static inline bool uc_mem_write_hook_installed_page(struct uc_struct *uc,
+                                                    hwaddr paddr, hwaddr len)
+{
+    return HOOK_EXISTS_OVERLAP(uc, UC_HOOK_MEM_WRITE, paddr, paddr + len - 1);
+}
+
 #endif
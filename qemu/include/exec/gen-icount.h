@@ -30,19 +30,33 @@ static inline void gen_io_end(TCGContext *tcg_ctx)
     tcg_temp_free_i32(tcg_ctx, tmp);
 }
 
-static inline void gen_tb_start(TCGContext *tcg_ctx, TranslationBlock *tb)
+static inline TCGOp *gen_tb_check_exit_request(TCGContext *tcg_ctx,
+                                               uint32_t num_insns)
 {
     TCGv_ptr puc = tcg_const_ptr(tcg_ctx, tcg_ctx->uc);
     TCGv_i32 tmp = tcg_const_i32(tcg_ctx, 0);
+    TCGv_i32 icount = tcg_const_i32(tcg_ctx, num_insns);
+    TCGOp *icount_insn = tcg_last_op(tcg_ctx);
     // Unicorn:
     //    We CANT'T use brcondi_i32 here or we will fail liveness analysis
     //    because it marks the end of BB
     if (tcg_ctx->delay_slot_flag != NULL) {
         tcg_gen_mov_i32(tcg_ctx, tmp, tcg_ctx->delay_slot_flag);
     }
-    gen_helper_check_exit_request(tcg_ctx, puc, tmp);
+    gen_helper_check_exit_request(tcg_ctx, puc, tmp, icount);
+    tcg_temp_free_i32(tcg_ctx, icount);
     tcg_temp_free_i32(tcg_ctx, tmp);
     tcg_temp_free_ptr(tcg_ctx, puc);
+
+    return icount_insn;
+}
+
+static inline void gen_tb_start(TCGContext *tcg_ctx, TranslationBlock *tb)
+{
+    // Unicorn: the prologue also charges the TB against the instruction
+    // budget of uc_emu_start(). The number of instructions is not known
+    // yet and gets patched in by gen_tb_end().
+    tcg_ctx->icount_start_insn = gen_tb_check_exit_request(tcg_ctx, 0);
 }
 
 static inline void gen_tb_end(TCGContext *tcg_ctx, TranslationBlock *tb, int num_insns)
@@ -51,11 +65,9 @@ static inline void gen_tb_end(TCGContext *tcg_ctx, TranslationBlock *tb, int num
         tcg_temp_free_i32(tcg_ctx, tcg_ctx->delay_slot_flag);
     }
     tcg_ctx->delay_slot_flag = NULL;
-    if (tb_cflags(tb) & CF_USE_ICOUNT) {
-        /* Update the num_insn immediate parameter now that we know
-         * the actual insn count.  */
-        tcg_set_insn_param(tcg_ctx->icount_start_insn, 1, num_insns);
-    }
+    /* Update the num_insn immediate parameter now that we know
+     * the actual insn count.  */
+    tcg_set_insn_param(tcg_ctx->icount_start_insn, 1, num_insns);
 
     tcg_gen_exit_tb(tcg_ctx, tb, TB_EXIT_REQUESTED);
 }
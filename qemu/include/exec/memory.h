@@ -323,6 +323,17 @@ struct MemoryRegion {
     struct uc_struct *uc;
     uint32_t perms;
     hwaddr end;
+
+    /* Unicorn: pages saved by the UC_SNAPSHOT_PAGE backend */
+    unsigned long *snapshot_dirty;
+    uint32_t snapshot_gen;
+
+    /*
+     * Unicorn: permissions of every page once uc_mem_protect() gave some
+     * pages of a RAM region different ones, perms is then their union.
+     * NULL while all pages have perms.
+     */
+    uint8_t *page_perms;
 };
 
 struct IOMMUMemoryRegion {
@@ -1216,10 +1227,16 @@ MemoryRegion *memory_map_ptr(struct uc_struct *uc, hwaddr begin, size_t size, ui
  MemoryRegion *memory_map_io(struct uc_struct *uc, ram_addr_t begin, size_t size, uc_cb_mmio_read_t read_cb,
                              uc_cb_mmio_write_t write_cb, void *user_data_read, void *user_data_write);
 MemoryRegion *memory_cow(struct uc_struct *uc, MemoryRegion *parrent, hwaddr begin, size_t size);
+bool memory_page_saved(struct uc_struct *uc, MemoryRegion *mr, hwaddr begin);
+void memory_restore_pages(struct uc_struct *uc);
 void memory_unmap(struct uc_struct *uc, MemoryRegion *mr);
 void memory_moveout(struct uc_struct *uc, MemoryRegion *mr);
 void memory_movein(struct uc_struct *uc, MemoryRegion *mr);
 int memory_free(struct uc_struct *uc);
+void memory_reset(struct uc_struct *uc);
+void memory_unmap_batch(struct uc_struct *uc, MemoryRegion **blocks, size_t count);
+void memory_transaction_begin(struct uc_struct *uc);
+void memory_transaction_commit(struct uc_struct *uc);
 bool flatview_copy(struct uc_struct *uc, FlatView *dst, FlatView *src, bool update_dispatcher);
 
 #endif
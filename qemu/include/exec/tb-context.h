@@ -22,6 +22,7 @@
 
 #include "qemu/thread.h"
 #include "qemu/qht.h"
+#include "qemu/queue.h"
 
 #define CODE_GEN_HTABLE_BITS     15
 #define CODE_GEN_HTABLE_SIZE     (1 << CODE_GEN_HTABLE_BITS)
@@ -29,9 +30,39 @@
 typedef struct TranslationBlock TranslationBlock;
 typedef struct TBContext TBContext;
 
+/*
+ * Unicorn: an inline cache entry of generated code, see
+ * tcg_gen_lookup_and_goto_ptr_ic(). @ptr is the host code of the TB at guest
+ * address @pc, the entry is valid while @gen equals TBContext.ic_gen.
+ */
+typedef struct TBInlineCache {
+    uint64_t pc;
+    void *ptr;
+    uint32_t gen;
+} TBInlineCache;
+
+#define TB_IC_WAYS          2
+#define TB_RET_STACK_SIZE   64
+/* same size and hash as tb_jmp_cache, see tb_exec_count_hash_func() */
+#define TB_EXEC_COUNT_SIZE  4096
+
 struct TBContext {
     struct qht htable;
 
+    /* TBs spanning two pages with incoming direct jumps */
+    QLIST_HEAD(, TranslationBlock) cross_page_tbs;
+
+    /* generation of all inline cache entries, see tb_ic_flush() */
+    uint32_t ic_gen;
+    /* shadow stack of the return address caches of calls, a ring buffer */
+    uint32_t ret_top;
+    TBInlineCache *ret_stack[TB_RET_STACK_SIZE];
+    /* never valid, fills the unused ret_stack slots */
+    TBInlineCache ret_empty;
+
+    /* executions of the TBs by pc hash, see tb_gen_superblock() */
+    uint32_t exec_count[TB_EXEC_COUNT_SIZE];
+
     /* statistics */
     unsigned tb_flush_count;
 };
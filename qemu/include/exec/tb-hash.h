@@ -47,6 +47,13 @@ static inline unsigned int tb_jmp_cache_hash_func(struct uc_struct *uc, target_u
            | (tmp & TB_JMP_ADDR_MASK));
 }
 
+/* Unicorn: index of the TB at @pc in TBContext.exec_count */
+static inline unsigned int tb_exec_count_hash_func(struct uc_struct *uc,
+                                                   target_ulong pc)
+{
+    return tb_jmp_cache_hash_func(uc, pc) & (TB_EXEC_COUNT_SIZE - 1);
+}
+
 static inline
 uint32_t tb_hash_func(tb_page_addr_t phys_pc, target_ulong pc, uint32_t flags,
                       uint32_t cf_mask, uint32_t trace_vcpu_dstate)
@@ -62,6 +62,7 @@ typedef enum DisasJumpType {
  * @num_insns: Number of translated instructions (including current).
  * @max_insns: Maximum number of instructions to be translated in this TB.
  * @singlestep_enabled: "Hardware" single stepping enabled.
+ * @num_jumps: Unicorn: number of direct jumps followed in a superblock.
  *
  * Architecture-agnostic disassembly context.
  */
@@ -73,6 +74,7 @@ typedef struct DisasContextBase {
     int num_insns;
     int max_insns;
     bool singlestep_enabled;
+    int num_jumps;
 } DisasContextBase;
 
 /**
@@ -143,6 +145,60 @@ void translator_loop(const TranslatorOps *ops, DisasContextBase *db,
 
 void translator_loop_temp_check(DisasContextBase *db);
 
+/**
+ * translator_add_successor:
+ * @tcg_ctx: TCG context translating the TB
+ * @dest: guest address the TB may directly branch or fall through to
+ *
+ * Unicorn: record a static successor of the TB being translated, so that
+ * UC_CTL_TB_REQUEST_CACHE_BATCH can translate it ahead of time as well.
+ * Targets call this wherever they decide whether a direct jump can be
+ * chained.
+ */
+static inline void translator_add_successor(TCGContext *tcg_ctx, uint64_t dest)
+{
+    int i;
+
+    for (i = 0; i < tcg_ctx->tb_nsucc; i++) {
+        if (tcg_ctx->tb_succ[i] == dest) {
+            return;
+        }
+    }
+    if (tcg_ctx->tb_nsucc < TCG_MAX_TB_SUCC) {
+        tcg_ctx->tb_succ[tcg_ctx->tb_nsucc++] = dest;
+    }
+}
+
+/**
+ * translator_follow_jump:
+ * @tcg_ctx: TCG context translating the TB
+ * @db: Disassembly context
+ * @insn_end: guest address after the jump instruction
+ * @dest: guest address the instruction jumps to unconditionally
+ *
+ * Unicorn: in a superblock (CF_SUPERBLOCK), decide whether translation goes
+ * on at @dest rather than ending the TB with a jump there. Only forward jumps
+ * within the page of the TB are followed, so that the TB still covers the
+ * range from its pc to db->pc_next.
+ */
+bool translator_follow_jump(TCGContext *tcg_ctx, DisasContextBase *db,
+                            target_ulong insn_end, target_ulong dest);
+
+/**
+ * translator_follow_branch:
+ * @tcg_ctx: TCG context translating the TB
+ * @db: Disassembly context
+ * @insn_end: guest address after the branch instruction
+ * @taken: guest address the instruction branches to
+ *
+ * Unicorn: like translator_follow_jump() for a conditional branch, picking
+ * the side whose TB has run more often. Returns 1 to go on at @taken, 0 to go
+ * on at @insn_end and -1 to end the TB. The target emits a side exit to the
+ * other destination.
+ */
+int translator_follow_branch(TCGContext *tcg_ctx, DisasContextBase *db,
+                             target_ulong insn_end, target_ulong taken);
+
 /*
  * Translator Load Functions
  *
@@ -223,6 +223,8 @@ struct qemu_work_item;
  * @can_do_io: Nonzero if memory-mapped IO is safe. Deterministic execution
  * requires that IO only be performed on the last instruction of a TB
  * so that interrupts take effect immediately.
+ * @cov_prev_loc: Unicorn: location of the previous block in the coverage
+ *                bitmap, shifted right by one. See UC_CTL_COVERAGE_BITMAP.
  * @cpu_ases: Pointer to array of CPUAddressSpaces (which define the
  *            AddressSpaces this CPU has)
  * @num_ases: number of CPUAddressSpaces in @cpu_ases
@@ -309,6 +311,7 @@ struct CPUState {
     int cluster_index;
     uint32_t halted;
     uint32_t can_do_io;
+    uint32_t cov_prev_loc;
     int32_t exception_index;
 
     struct uc_struct* uc;
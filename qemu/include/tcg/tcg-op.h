@@ -29,48 +29,6 @@
 #include "exec/helper-proto.h"
 #include "exec/helper-gen.h"
 
-static inline void gen_uc_tracecode(TCGContext *tcg_ctx, int32_t size, int32_t type, void *uc, uint64_t pc)
-{
-    TCGv_i32 tsize = tcg_const_i32(tcg_ctx, size);
-    TCGv_i32 ttype;
-    TCGv_ptr tuc = tcg_const_ptr(tcg_ctx, uc);
-    TCGv_i64 tpc = tcg_const_i64(tcg_ctx, pc);
-    TCGv_ptr tdata;
-    uc_engine* puc = uc;
-    struct list_item *cur;
-    struct hook* hk;
-    TCGTemp* args[] = {
-        tcgv_ptr_temp(tcg_ctx, tuc),
-        tcgv_i64_temp(tcg_ctx, tpc),
-        tcgv_i32_temp(tcg_ctx, tsize),
-        0
-    };
-
-    const int hook_type = type & UC_HOOK_IDX_MASK;
-    if (puc->hooks_count[hook_type] == 1 && !(type & UC_HOOK_FLAG_NO_STOP)) {
-        cur = puc->hook[hook_type].head;
-        
-        while (cur) {
-            hk = cur->data;
-            if (!hk->to_delete) {
-                tdata = tcg_const_ptr(tcg_ctx, hk->user_data);
-                args[3] = tcgv_ptr_temp(tcg_ctx, tdata);
-                puc->add_inline_hook(uc, hk, (void**)args, 4);
-                tcg_temp_free_ptr(tcg_ctx, tdata);
-            }
-            cur = cur->next;
-        }
-
-    } else {
-        ttype = tcg_const_i32(tcg_ctx, type);
-        gen_helper_uc_tracecode(tcg_ctx, tsize, ttype, tuc, tpc);
-        tcg_temp_free_i32(tcg_ctx, ttype);
-    }
-    tcg_temp_free_i64(tcg_ctx, tpc);
-    tcg_temp_free_ptr(tcg_ctx, tuc);
-    tcg_temp_free_i32(tcg_ctx, tsize);
-}
-
 static inline void gen_uc_traceopcode(TCGContext *tcg_ctx, void* hook, TCGv_i64 arg1, TCGv_i64 arg2, uint32_t size, void *uc, uint64_t pc)
 {
     TCGv_ptr thook = tcg_const_ptr(tcg_ctx, hook);
@@ -923,6 +881,47 @@ void tcg_gen_goto_tb(TCGContext *tcg_ctx, unsigned idx);
  */
 void tcg_gen_lookup_and_goto_ptr(TCGContext *tcg_ctx);
 
+/**
+ * tcg_gen_lookup_and_goto_ptr_ic() - tcg_gen_lookup_and_goto_ptr() with an
+ * inline cache of the last destinations of this jump
+ * @tb: the TB being translated
+ * @dest: the destination, the CPU state must already point there
+ *
+ * The generated code compares @dest with the cached destinations before
+ * looking it up. The caller must make sure that the flags of the next TB only
+ * depend on the flags of @tb and on @dest, e.g. ARM passes the Thumb bit in
+ * bit 0 of @dest.
+ *
+ * Unicorn: only used if UC_TB_IC_INDIRECT is enabled.
+ */
+void tcg_gen_lookup_and_goto_ptr_ic(TCGContext *tcg_ctx, TranslationBlock *tb,
+                                    TCGv_i64 dest);
+
+/**
+ * tcg_gen_lookup_and_goto_ptr_ret() - tcg_gen_lookup_and_goto_ptr_ic() for
+ * a function return
+ * @tb: the TB being translated
+ * @dest: the return address, as in tcg_gen_lookup_and_goto_ptr_ic()
+ *
+ * Pops the return address pushed by tcg_gen_push_return() and jumps to the
+ * TB cached for it if it matches @dest.
+ *
+ * Unicorn: only used if UC_TB_IC_RETURN is enabled.
+ */
+void tcg_gen_lookup_and_goto_ptr_ret(TCGContext *tcg_ctx, TranslationBlock *tb,
+                                     TCGv_i64 dest);
+
+/**
+ * tcg_gen_push_return() - push the return address of a call
+ * @tb: the TB being translated, the call must end it
+ * @ret: the return address, as the return will pass it to
+ *       tcg_gen_lookup_and_goto_ptr_ret()
+ *
+ * Unicorn: only used if UC_TB_IC_RETURN is enabled.
+ */
+void tcg_gen_push_return(TCGContext *tcg_ctx, TranslationBlock *tb,
+                         uint64_t ret);
+
 #if TARGET_LONG_BITS == 32
 #define tcg_temp_new tcg_temp_new_i32
 #define tcg_global_reg_new tcg_global_reg_new_i32
@@ -1401,6 +1400,105 @@ static inline void tcg_gen_trunc_ptr_i32(TCGContext *tcg_ctx, TCGv_i32 r, TCGv_p
 #endif
 }
 
+// Unicorn: at most this many code or block hooks covering one address are
+// called directly from the generated code, more go through the generic
+// helper_uc_tracecode().
+#define UC_HOOK_INLINE_MAX 8
+
+static inline void gen_uc_tracecode(TCGContext *tcg_ctx, int32_t size, int32_t type, void *uc, uint64_t pc)
+{
+    TCGv_i32 tsize;
+    TCGv_i32 ttype;
+    TCGv_ptr tuc;
+    TCGv_i64 tpc;
+    TCGv_ptr tdata;
+    TCGv_ptr thook;
+    TCGv_i32 tflag;
+    TCGLabel *done, *skip;
+    uc_engine* puc = uc;
+    struct hook **hcur, **hend;
+    struct hook* hk;
+    TCGTemp* args[4];
+    int count = 0;
+    int i = 0;
+
+    // Resolve now which hooks cover pc, so that each of them is called
+    // directly. Hooks which mustn't stop the emulation still need the
+    // helper to revert uc_emu_stop().
+    const int hook_type = type & UC_HOOK_IDX_MASK;
+    if (!(type & UC_HOOK_FLAG_NO_STOP)) {
+        for (hcur = hook_index_lookup(puc, hook_type, pc, &hend); hcur < hend;
+             hcur++) {
+            if (HOOK_BOUND_CHECK(*hcur, pc)) {
+                count++;
+            }
+        }
+    }
+
+    if (count == 0 || count > UC_HOOK_INLINE_MAX) {
+        tsize = tcg_const_i32(tcg_ctx, size);
+        ttype = tcg_const_i32(tcg_ctx, type);
+        tuc = tcg_const_ptr(tcg_ctx, uc);
+        tpc = tcg_const_i64(tcg_ctx, pc);
+        gen_helper_uc_tracecode(tcg_ctx, tsize, ttype, tuc, tpc);
+        tcg_temp_free_i64(tcg_ctx, tpc);
+        tcg_temp_free_ptr(tcg_ctx, tuc);
+        tcg_temp_free_i32(tcg_ctx, ttype);
+        tcg_temp_free_i32(tcg_ctx, tsize);
+        return;
+    }
+
+    // The size must stay the first op emitted, the block hook patches it
+    // once the size of the block is known. It lives across the checks below.
+    tsize = tcg_const_local_i32(tcg_ctx, size);
+    done = gen_new_label(tcg_ctx);
+
+    for (hcur = hook_index_lookup(puc, hook_type, pc, &hend); hcur < hend;
+         hcur++) {
+        hk = *hcur;
+        if (!HOOK_BOUND_CHECK(hk, pc)) {
+            continue;
+        }
+
+        // the last callback may already asked to stop emulation
+        if (i++) {
+            tuc = tcg_const_ptr(tcg_ctx, uc);
+            tflag = tcg_temp_new_i32(tcg_ctx);
+            tcg_gen_ld8u_i32(tcg_ctx, tflag, tuc,
+                             offsetof(struct uc_struct, stop_request));
+            tcg_gen_brcondi_i32(tcg_ctx, TCG_COND_NE, tflag, 0, done);
+            tcg_temp_free_i32(tcg_ctx, tflag);
+            tcg_temp_free_ptr(tcg_ctx, tuc);
+        }
+
+        // a callback may have deleted the hook, the block is only
+        // retranslated without it once it has finished
+        skip = gen_new_label(tcg_ctx);
+        thook = tcg_const_ptr(tcg_ctx, hk);
+        tflag = tcg_temp_new_i32(tcg_ctx);
+        tcg_gen_ld8u_i32(tcg_ctx, tflag, thook, offsetof(struct hook, to_delete));
+        tcg_gen_brcondi_i32(tcg_ctx, TCG_COND_NE, tflag, 0, skip);
+        tcg_temp_free_i32(tcg_ctx, tflag);
+        tcg_temp_free_ptr(tcg_ctx, thook);
+
+        tuc = tcg_const_ptr(tcg_ctx, uc);
+        tpc = tcg_const_i64(tcg_ctx, pc);
+        tdata = tcg_const_ptr(tcg_ctx, hk->user_data);
+        args[0] = tcgv_ptr_temp(tcg_ctx, tuc);
+        args[1] = tcgv_i64_temp(tcg_ctx, tpc);
+        args[2] = tcgv_i32_temp(tcg_ctx, tsize);
+        args[3] = tcgv_ptr_temp(tcg_ctx, tdata);
+        puc->add_inline_hook(uc, hk, (void**)args, 4);
+        tcg_temp_free_ptr(tcg_ctx, tdata);
+        tcg_temp_free_i64(tcg_ctx, tpc);
+        tcg_temp_free_ptr(tcg_ctx, tuc);
+        gen_set_label(tcg_ctx, skip);
+    }
+
+    gen_set_label(tcg_ctx, done);
+    tcg_temp_free_i32(tcg_ctx, tsize);
+}
+
 #undef PTR
 #undef NAT
 
@@ -286,6 +286,9 @@ typedef struct TCGPool {
 #endif
 #define TCG_MAX_INSNS 512
 
+/* Unicorn: static successors recorded per TB, see translator_add_successor */
+#define TCG_MAX_TB_SUCC 4
+
 /* when the size of the arguments of a called function is smaller than
    this value, they are statically allocated in the TB stack frame */
 #define TCG_STATIC_CALL_ARGS_SIZE 128
@@ -690,6 +693,9 @@ struct TCGContext {
     TBContext tb_ctx;
     /* qemu/include/exec/gen-icount.h */
     TCGOp *icount_start_insn;
+    /* qemu/include/exec/translator.h */
+    uint64_t tb_succ[TCG_MAX_TB_SUCC];
+    int tb_nsucc;
     /* qemu/tcg/tcg.c */
     GHashTable *helper_table;
     GHashTable *custom_helper_infos; // To support inline hooks.
@@ -1588,11 +1594,4 @@ struct jit_code_entry {
 void uc_del_inline_hook(uc_engine *uc, struct hook *hk);
 void uc_add_inline_hook(uc_engine *uc, struct hook *hk, void** args, int args_len);
 
-static inline bool tcg_uc_has_hookmem(TCGContext *s)
-{
-    return HOOK_EXISTS(s->uc, UC_HOOK_MEM_READ) ||
-        HOOK_EXISTS(s->uc, UC_HOOK_MEM_READ_AFTER) ||
-        HOOK_EXISTS(s->uc, UC_HOOK_MEM_WRITE);
-}
-
 #endif /* TCG_H */
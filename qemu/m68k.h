@@ -127,10 +127,16 @@
 #define memory_map_io memory_map_io_m68k
 #define memory_map_ptr memory_map_ptr_m68k
 #define memory_cow memory_cow_m68k
+#define memory_page_saved memory_page_saved_m68k
+#define memory_restore_pages memory_restore_pages_m68k
 #define memory_unmap memory_unmap_m68k
 #define memory_moveout memory_moveout_m68k
 #define memory_movein memory_movein_m68k
 #define memory_free memory_free_m68k
+#define memory_reset memory_reset_m68k
+#define memory_unmap_batch memory_unmap_batch_m68k
+#define memory_transaction_begin memory_transaction_begin_m68k
+#define memory_transaction_commit memory_transaction_commit_m68k
 #define flatview_unref flatview_unref_m68k
 #define address_space_get_flatview address_space_get_flatview_m68k
 #define memory_region_transaction_begin memory_region_transaction_begin_m68k
@@ -1273,6 +1279,15 @@
 #define tb_check_watchpoint tb_check_watchpoint_m68k
 #define cpu_io_recompile cpu_io_recompile_m68k
 #define tb_flush_jmp_cache tb_flush_jmp_cache_m68k
+#define tb_flush_cross_page_jumps tb_flush_cross_page_jumps_m68k
+#define tb_ic_flush tb_ic_flush_m68k
+#define tb_gen_superblock tb_gen_superblock_m68k
+#define translator_follow_jump translator_follow_jump_m68k
+#define translator_follow_branch translator_follow_branch_m68k
+#define tcg_gen_lookup_and_goto_ptr_ic tcg_gen_lookup_and_goto_ptr_ic_m68k
+#define tcg_gen_lookup_and_goto_ptr_ret tcg_gen_lookup_and_goto_ptr_ret_m68k
+#define tcg_gen_push_return tcg_gen_push_return_m68k
+#define helper_lookup_tb_ptr_ic helper_lookup_tb_ptr_ic_m68k
 #define tcg_flush_softmmu_tlb tcg_flush_softmmu_tlb_m68k
 #define translator_loop_temp_check translator_loop_temp_check_m68k
 #define translator_loop translator_loop_m68k
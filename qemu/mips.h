@@ -127,10 +127,16 @@
 #define memory_map_io memory_map_io_mips
 #define memory_map_ptr memory_map_ptr_mips
 #define memory_cow memory_cow_mips
+#define memory_page_saved memory_page_saved_mips
+#define memory_restore_pages memory_restore_pages_mips
 #define memory_unmap memory_unmap_mips
 #define memory_moveout memory_moveout_mips
 #define memory_movein memory_movein_mips
 #define memory_free memory_free_mips
+#define memory_reset memory_reset_mips
+#define memory_unmap_batch memory_unmap_batch_mips
+#define memory_transaction_begin memory_transaction_begin_mips
+#define memory_transaction_commit memory_transaction_commit_mips
 #define flatview_unref flatview_unref_mips
 #define address_space_get_flatview address_space_get_flatview_mips
 #define memory_region_transaction_begin memory_region_transaction_begin_mips
@@ -1273,6 +1279,15 @@
 #define tb_check_watchpoint tb_check_watchpoint_mips
 #define cpu_io_recompile cpu_io_recompile_mips
 #define tb_flush_jmp_cache tb_flush_jmp_cache_mips
+#define tb_flush_cross_page_jumps tb_flush_cross_page_jumps_mips
+#define tb_ic_flush tb_ic_flush_mips
+#define tb_gen_superblock tb_gen_superblock_mips
+#define translator_follow_jump translator_follow_jump_mips
+#define translator_follow_branch translator_follow_branch_mips
+#define tcg_gen_lookup_and_goto_ptr_ic tcg_gen_lookup_and_goto_ptr_ic_mips
+#define tcg_gen_lookup_and_goto_ptr_ret tcg_gen_lookup_and_goto_ptr_ret_mips
+#define tcg_gen_push_return tcg_gen_push_return_mips
+#define helper_lookup_tb_ptr_ic helper_lookup_tb_ptr_ic_mips
 #define tcg_flush_softmmu_tlb tcg_flush_softmmu_tlb_mips
 #define translator_loop_temp_check translator_loop_temp_check_mips
 #define translator_loop translator_loop_mips
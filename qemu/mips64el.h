@@ -127,10 +127,16 @@
 #define memory_map_io memory_map_io_mips64el
 #define memory_map_ptr memory_map_ptr_mips64el
 #define memory_cow memory_cow_mips64el
+#define memory_page_saved memory_page_saved_mips64el
+#define memory_restore_pages memory_restore_pages_mips64el
 #define memory_unmap memory_unmap_mips64el
 #define memory_moveout memory_moveout_mips64el
 #define memory_movein memory_movein_mips64el
 #define memory_free memory_free_mips64el
+#define memory_reset memory_reset_mips64el
+#define memory_unmap_batch memory_unmap_batch_mips64el
+#define memory_transaction_begin memory_transaction_begin_mips64el
+#define memory_transaction_commit memory_transaction_commit_mips64el
 #define flatview_unref flatview_unref_mips64el
 #define address_space_get_flatview address_space_get_flatview_mips64el
 #define memory_region_transaction_begin memory_region_transaction_begin_mips64el
@@ -1273,6 +1279,15 @@
 #define tb_check_watchpoint tb_check_watchpoint_mips64el
 #define cpu_io_recompile cpu_io_recompile_mips64el
 #define tb_flush_jmp_cache tb_flush_jmp_cache_mips64el
+#define tb_flush_cross_page_jumps tb_flush_cross_page_jumps_mips64el
+#define tb_ic_flush tb_ic_flush_mips64el
+#define tb_gen_superblock tb_gen_superblock_mips64el
+#define translator_follow_jump translator_follow_jump_mips64el
+#define translator_follow_branch translator_follow_branch_mips64el
+#define tcg_gen_lookup_and_goto_ptr_ic tcg_gen_lookup_and_goto_ptr_ic_mips64el
+#define tcg_gen_lookup_and_goto_ptr_ret tcg_gen_lookup_and_goto_ptr_ret_mips64el
+#define tcg_gen_push_return tcg_gen_push_return_mips64el
+#define helper_lookup_tb_ptr_ic helper_lookup_tb_ptr_ic_mips64el
 #define tcg_flush_softmmu_tlb tcg_flush_softmmu_tlb_mips64el
 #define translator_loop_temp_check translator_loop_temp_check_mips64el
 #define translator_loop translator_loop_mips64el
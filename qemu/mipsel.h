@@ -127,10 +127,16 @@
 #define memory_map_io memory_map_io_mipsel
 #define memory_map_ptr memory_map_ptr_mipsel
 #define memory_cow memory_cow_mipsel
+#define memory_page_saved memory_page_saved_mipsel
+#define memory_restore_pages memory_restore_pages_mipsel
 #define memory_unmap memory_unmap_mipsel
 #define memory_moveout memory_moveout_mipsel
 #define memory_movein memory_movein_mipsel
 #define memory_free memory_free_mipsel
+#define memory_reset memory_reset_mipsel
+#define memory_unmap_batch memory_unmap_batch_mipsel
+#define memory_transaction_begin memory_transaction_begin_mipsel
+#define memory_transaction_commit memory_transaction_commit_mipsel
 #define flatview_unref flatview_unref_mipsel
 #define address_space_get_flatview address_space_get_flatview_mipsel
 #define memory_region_transaction_begin memory_region_transaction_begin_mipsel
@@ -1273,6 +1279,15 @@
 #define tb_check_watchpoint tb_check_watchpoint_mipsel
 #define cpu_io_recompile cpu_io_recompile_mipsel
 #define tb_flush_jmp_cache tb_flush_jmp_cache_mipsel
+#define tb_flush_cross_page_jumps tb_flush_cross_page_jumps_mipsel
+#define tb_ic_flush tb_ic_flush_mipsel
+#define tb_gen_superblock tb_gen_superblock_mipsel
+#define translator_follow_jump translator_follow_jump_mipsel
+#define translator_follow_branch translator_follow_branch_mipsel
+#define tcg_gen_lookup_and_goto_ptr_ic tcg_gen_lookup_and_goto_ptr_ic_mipsel
+#define tcg_gen_lookup_and_goto_ptr_ret tcg_gen_lookup_and_goto_ptr_ret_mipsel
+#define tcg_gen_push_return tcg_gen_push_return_mipsel
+#define helper_lookup_tb_ptr_ic helper_lookup_tb_ptr_ic_mipsel
 #define tcg_flush_softmmu_tlb tcg_flush_softmmu_tlb_mipsel
 #define translator_loop_temp_check translator_loop_temp_check_mipsel
 #define translator_loop translator_loop_mipsel
@@ -127,10 +127,16 @@
 #define memory_map_io memory_map_io_ppc
 #define memory_map_ptr memory_map_ptr_ppc
 #define memory_cow memory_cow_ppc
+#define memory_page_saved memory_page_saved_ppc
+#define memory_restore_pages memory_restore_pages_ppc
 #define memory_unmap memory_unmap_ppc
 #define memory_moveout memory_moveout_ppc
 #define memory_movein memory_movein_ppc
 #define memory_free memory_free_ppc
+#define memory_reset memory_reset_ppc
+#define memory_unmap_batch memory_unmap_batch_ppc
+#define memory_transaction_begin memory_transaction_begin_ppc
+#define memory_transaction_commit memory_transaction_commit_ppc
 #define flatview_unref flatview_unref_ppc
 #define address_space_get_flatview address_space_get_flatview_ppc
 #define memory_region_transaction_begin memory_region_transaction_begin_ppc
@@ -1273,6 +1279,15 @@
 #define tb_check_watchpoint tb_check_watchpoint_ppc
 #define cpu_io_recompile cpu_io_recompile_ppc
 #define tb_flush_jmp_cache tb_flush_jmp_cache_ppc
+#define tb_flush_cross_page_jumps tb_flush_cross_page_jumps_ppc
+#define tb_ic_flush tb_ic_flush_ppc
+#define tb_gen_superblock tb_gen_superblock_ppc
+#define translator_follow_jump translator_follow_jump_ppc
+#define translator_follow_branch translator_follow_branch_ppc
+#define tcg_gen_lookup_and_goto_ptr_ic tcg_gen_lookup_and_goto_ptr_ic_ppc
+#define tcg_gen_lookup_and_goto_ptr_ret tcg_gen_lookup_and_goto_ptr_ret_ppc
+#define tcg_gen_push_return tcg_gen_push_return_ppc
+#define helper_lookup_tb_ptr_ic helper_lookup_tb_ptr_ic_ppc
 #define tcg_flush_softmmu_tlb tcg_flush_softmmu_tlb_ppc
 #define translator_loop_temp_check translator_loop_temp_check_ppc
 #define translator_loop translator_loop_ppc
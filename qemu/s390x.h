@@ -127,10 +127,16 @@
 #define memory_map_io memory_map_io_s390x
 #define memory_map_ptr memory_map_ptr_s390x
 #define memory_cow memory_cow_s390x
+#define memory_page_saved memory_page_saved_s390x
+#define memory_restore_pages memory_restore_pages_s390x
 #define memory_unmap memory_unmap_s390x
 #define memory_moveout memory_moveout_s390x
 #define memory_movein memory_movein_s390x
 #define memory_free memory_free_s390x
+#define memory_reset memory_reset_s390x
+#define memory_unmap_batch memory_unmap_batch_s390x
+#define memory_transaction_begin memory_transaction_begin_s390x
+#define memory_transaction_commit memory_transaction_commit_s390x
 #define flatview_unref flatview_unref_s390x
 #define address_space_get_flatview address_space_get_flatview_s390x
 #define memory_region_transaction_begin memory_region_transaction_begin_s390x
@@ -1273,6 +1279,15 @@
 #define tb_check_watchpoint tb_check_watchpoint_s390x
 #define cpu_io_recompile cpu_io_recompile_s390x
 #define tb_flush_jmp_cache tb_flush_jmp_cache_s390x
+#define tb_flush_cross_page_jumps tb_flush_cross_page_jumps_s390x
+#define tb_ic_flush tb_ic_flush_s390x
+#define tb_gen_superblock tb_gen_superblock_s390x
+#define translator_follow_jump translator_follow_jump_s390x
+#define translator_follow_branch translator_follow_branch_s390x
+#define tcg_gen_lookup_and_goto_ptr_ic tcg_gen_lookup_and_goto_ptr_ic_s390x
+#define tcg_gen_lookup_and_goto_ptr_ret tcg_gen_lookup_and_goto_ptr_ret_s390x
+#define tcg_gen_push_return tcg_gen_push_return_s390x
+#define helper_lookup_tb_ptr_ic helper_lookup_tb_ptr_ic_s390x
 #define tcg_flush_softmmu_tlb tcg_flush_softmmu_tlb_s390x
 #define translator_loop_temp_check translator_loop_temp_check_s390x
 #define translator_loop translator_loop_s390x
@@ -198,6 +198,11 @@ static inline gboolean uc_exit_invalidate_iter(gpointer key, gpointer val, gpoin
         //
         // This function is designed to used with g_tree_foreach
         uc->uc_invalidate_tb(uc, exit - 1, 1);
+
+        // The empty exit TB translated at the exit itself is only caught by
+        // the call above when it shares a page with exit - 1. Nothing else
+        // flushes it any more, so drop it explicitly.
+        uc->uc_invalidate_tb(uc, exit, 1);
     }
 
     return false;
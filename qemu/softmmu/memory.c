@@ -17,6 +17,7 @@
 #include "cpu.h"
 #include "exec/memory.h"
 #include "qemu/bitops.h"
+#include "qemu/bitmap.h"
 
 #include "exec/memory-internal.h"
 #include "exec/ram_addr.h"
@@ -94,16 +95,109 @@ static void make_contained(struct uc_struct *uc, MemoryRegion *current)
     memory_region_add_subregion(uc->system_memory, addr, container);
 }
 
+/* The pages of mr saved since the last snapshot or restore. */
+static unsigned long *memory_snapshot_dirty(struct uc_struct *uc, MemoryRegion *mr)
+{
+    long pages = int128_get64(mr->size) >> TARGET_PAGE_BITS;
+
+    if (!mr->snapshot_dirty) {
+        mr->snapshot_dirty = bitmap_new(pages);
+        mr->snapshot_gen = uc->snapshot_gen;
+    } else if (mr->snapshot_gen != uc->snapshot_gen) {
+        bitmap_zero(mr->snapshot_dirty, pages);
+        mr->snapshot_gen = uc->snapshot_gen;
+    }
+    return mr->snapshot_dirty;
+}
+
+bool memory_page_saved(struct uc_struct *uc, MemoryRegion *mr, hwaddr begin)
+{
+    hwaddr offset = begin - mr->container->addr - mr->addr;
+
+    return mr->snapshot_dirty && mr->snapshot_gen == uc->snapshot_gen &&
+           test_bit(offset >> TARGET_PAGE_BITS, mr->snapshot_dirty);
+}
+
+/*
+ * UC_SNAPSHOT_PAGE backend: save the pages about to be written to the page
+ * pool once per snapshot, the region itself is written in place.
+ */
+static MemoryRegion *memory_cow_page(struct uc_struct *uc, MemoryRegion *current, hwaddr begin, size_t size)
+{
+    struct uc_snapshot_page page;
+    unsigned long *dirty;
+    hwaddr offset;
+    hwaddr end;
+
+    if (!current->ram) {
+        return current;
+    }
+
+    dirty = memory_snapshot_dirty(uc, current);
+    offset = begin - current->container->addr - current->addr;
+    end = MIN(offset + size, int128_get64(current->size));
+
+    for (; offset < end; offset += TARGET_PAGE_SIZE, begin += TARGET_PAGE_SIZE) {
+        if (test_and_set_bit(offset >> TARGET_PAGE_BITS, dirty)) {
+            continue;
+        }
+        if (uc->snapshot_pages->len == uc->snapshot_pool_len) {
+            uc->snapshot_pool_len = MAX(uc->snapshot_pool_len * 2, 64);
+            uc->snapshot_pool = g_realloc(uc->snapshot_pool,
+                                          uc->snapshot_pool_len * TARGET_PAGE_SIZE);
+        }
+        memcpy(uc->snapshot_pool + uc->snapshot_pages->len * TARGET_PAGE_SIZE,
+               ramblock_ptr(current->ram_block, offset), TARGET_PAGE_SIZE);
+        page.mr = current;
+        page.offset = offset;
+        page.addr = begin;
+        page.level = uc->snapshot_level;
+        g_array_append_val(uc->snapshot_pages, page);
+    }
+
+    return current;
+}
+
+/*
+ * Copy the pages saved since the latest snapshot back, newest first so the
+ * oldest copy of a page saved on several levels wins.
+ */
+void memory_restore_pages(struct uc_struct *uc)
+{
+    struct uc_snapshot_page *page;
+    guint i;
+
+    for (i = uc->snapshot_pages->len; i > 0; i--) {
+        page = &g_array_index(uc->snapshot_pages, struct uc_snapshot_page, i - 1);
+        if (page->level < uc->snapshot_level) {
+            break;
+        }
+        memcpy(ramblock_ptr(page->mr->ram_block, page->offset),
+               uc->snapshot_pool + (i - 1) * TARGET_PAGE_SIZE, TARGET_PAGE_SIZE);
+        if (uc->cpu && (page->mr->perms & UC_PROT_EXEC)) {
+            uc->uc_invalidate_tb(uc, page->addr, TARGET_PAGE_SIZE);
+        }
+    }
+    g_array_set_size(uc->snapshot_pages, i);
+    uc->snapshot_gen++;
+}
+
 MemoryRegion *memory_cow(struct uc_struct *uc, MemoryRegion *current, hwaddr begin, size_t size)
 {
     hwaddr addr;
     hwaddr offset;
     hwaddr current_offset;
-    MemoryRegion *ram = g_new(MemoryRegion, 1);
+    MemoryRegion *ram;
 
     assert((begin & ~TARGET_PAGE_MASK) == 0);
     assert((size & ~TARGET_PAGE_MASK) == 0);
 
+    if (uc->snapshot_type == UC_SNAPSHOT_PAGE) {
+        return memory_cow_page(uc, current, begin, size);
+    }
+
+    ram = g_new(MemoryRegion, 1);
+
     if (current->container == uc->system_memory) {
         make_contained(uc, current);
     }
@@ -117,6 +211,10 @@ MemoryRegion *memory_cow(struct uc_struct *uc, MemoryRegion *current, hwaddr beg
     }
 
     memcpy(ramblock_ptr(ram->ram_block, 0), ramblock_ptr(current->ram_block, current_offset), size);
+    if (current->page_perms) {
+        ram->page_perms = g_memdup(current->page_perms + (current_offset >> TARGET_PAGE_BITS),
+                                   size >> TARGET_PAGE_BITS);
+    }
     memory_region_add_subregion_overlap(current->container, offset, ram, uc->snapshot_level);
 
     if (uc->cpu) {
@@ -305,6 +403,61 @@ void memory_unmap(struct uc_struct *uc, MemoryRegion *mr)
     memory_region_remove_mapped_block(uc, mr, true);
 }
 
+/*
+ * Unmap the mapped blocks given, in the order of uc->mapped_blocks. The
+ * memory topology is rebuilt once and mapped_blocks compacted in one pass.
+ */
+void memory_unmap_batch(struct uc_struct *uc, MemoryRegion **blocks, size_t count)
+{
+    size_t i, j, n;
+
+    memory_transaction_begin(uc);
+    for (i = 0; i < count; i++) {
+        if (uc->cpu) {
+            uc->uc_invalidate_tb(uc, blocks[i]->addr, int128_get64(blocks[i]->size));
+        }
+        memory_region_del_subregion(uc->system_memory, blocks[i]);
+    }
+    memory_transaction_commit(uc);
+
+    for (i = 0, j = 0, n = 0; i < uc->mapped_block_count; i++) {
+        if (j < count && uc->mapped_blocks[i] == blocks[j]) {
+            j++;
+            continue;
+        }
+        uc->mapped_blocks[n++] = uc->mapped_blocks[i];
+    }
+    uc->mapped_block_count = n;
+
+    /* the old flatview is gone, the blocks may be freed now */
+    for (i = 0; i < count; i++) {
+        blocks[i]->destructor(blocks[i]);
+        g_free(blocks[i]);
+    }
+
+    if (uc->cpu) {
+        tlb_flush(uc->cpu);
+    }
+}
+
+/*
+ * Unicorn: defer rebuilding the memory topology of the changes made until the
+ * outermost memory_transaction_commit(), which rebuilds it once.
+ */
+void memory_transaction_begin(struct uc_struct *uc)
+{
+    uc->memory_region_transaction_depth++;
+}
+
+void memory_transaction_commit(struct uc_struct *uc)
+{
+    assert(uc->memory_region_transaction_depth > 0);
+    if (--uc->memory_region_transaction_depth == 0) {
+        /* not a single region changed, rebuild everything */
+        memory_region_transaction_commit(uc->system_memory);
+    }
+}
+
 int memory_free(struct uc_struct *uc)
 {
     MemoryRegion *subregion, *subregion_next;
@@ -321,6 +474,47 @@ int memory_free(struct uc_struct *uc)
     return 0;
 }
 
+/*
+ * Drop every mapping together with the regions kept aside for snapshots and
+ * the saved snapshot pages, leaving the address space as uc_open() made it.
+ */
+void memory_reset(struct uc_struct *uc)
+{
+    MemoryRegion *subregion, *subregion_next;
+    MemoryRegion *mr = uc->system_memory;
+    GArray *regions = g_array_new(false, false, sizeof(MemoryRegion *));
+    guint i;
+
+    memory_region_transaction_begin();
+    QTAILQ_FOREACH_SAFE(subregion, &mr->subregions, subregions_link, subregion_next) {
+        subregion->enabled = false;
+        memory_region_del_subregion(mr, subregion);
+        g_array_append_val(regions, subregion);
+    }
+    uc->memory_region_update_pending = true;
+    memory_region_transaction_commit(mr);
+
+    /* the old flatview is gone, the regions may be freed now */
+    g_array_append_vals(regions, uc->unmapped_regions->data,
+                        uc->unmapped_regions->len);
+    for (i = 0; i < regions->len; i++) {
+        subregion = g_array_index(regions, MemoryRegion *, i);
+        subregion->destructor(subregion);
+        g_free(subregion);
+    }
+    g_array_free(regions, true);
+
+    g_array_set_size(uc->unmapped_regions, 0);
+    g_array_set_size(uc->snapshot_pages, 0);
+    uc->mapped_block_count = 0;
+    uc->snapshot_level = 0;
+    uc->snapshot_gen++;
+
+    if (uc->cpu) {
+        tlb_flush(uc->cpu);
+    }
+}
+
 static AddrRange addrrange_make(Int128 start, Int128 size)
 {
     return (AddrRange) { start, size };
@@ -1068,6 +1262,10 @@ static void memory_region_transaction_commit(MemoryRegion *mr)
     if (as)
         fv = address_space_to_flatview(as);
 
+    if (mr->uc->memory_region_transaction_depth) {
+        return;
+    }
+
     if (mr->uc->memory_region_update_pending) {
         MEMORY_LISTENER_CALL_GLOBAL(mr->uc, begin, Forward);
 
@@ -1091,6 +1289,8 @@ static void memory_region_destructor_ram(MemoryRegion *mr)
 {
     memory_region_filter_subregions(mr, 0);
     qemu_ram_free(mr->uc, mr->ram_block);
+    g_free(mr->snapshot_dirty);
+    g_free(mr->page_perms);
 }
 
 static void memory_region_destructor_container(MemoryRegion *mr)
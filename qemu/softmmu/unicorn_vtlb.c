@@ -53,11 +53,11 @@ bool unicorn_fill_tlb(CPUState *cs, vaddr address, int size,
     struct uc_struct *uc = cs->uc;
     uc_tlb_entry e;
     struct hook *hook;
-    HOOK_FOREACH_VAR_DECLARE;
+    HOOK_FOREACH_BOUNDED_VAR_DECLARE;
 
     cpu_restore_state(cs, retaddr, false);
 
-    HOOK_FOREACH(uc, hook, UC_HOOK_TLB_FILL) {
+    HOOK_FOREACH_BOUNDED(uc, hook, UC_HOOK_TLB_FILL, address) {
         if (hook->to_delete) {
             continue;
         }
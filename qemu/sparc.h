@@ -127,10 +127,16 @@
 #define memory_map_io memory_map_io_sparc
 #define memory_map_ptr memory_map_ptr_sparc
 #define memory_cow memory_cow_sparc
+#define memory_page_saved memory_page_saved_sparc
+#define memory_restore_pages memory_restore_pages_sparc
 #define memory_unmap memory_unmap_sparc
 #define memory_moveout memory_moveout_sparc
 #define memory_movein memory_movein_sparc
 #define memory_free memory_free_sparc
+#define memory_reset memory_reset_sparc
+#define memory_unmap_batch memory_unmap_batch_sparc
+#define memory_transaction_begin memory_transaction_begin_sparc
+#define memory_transaction_commit memory_transaction_commit_sparc
 #define flatview_unref flatview_unref_sparc
 #define address_space_get_flatview address_space_get_flatview_sparc
 #define memory_region_transaction_begin memory_region_transaction_begin_sparc
@@ -1273,6 +1279,15 @@
 #define tb_check_watchpoint tb_check_watchpoint_sparc
 #define cpu_io_recompile cpu_io_recompile_sparc
 #define tb_flush_jmp_cache tb_flush_jmp_cache_sparc
+#define tb_flush_cross_page_jumps tb_flush_cross_page_jumps_sparc
+#define tb_ic_flush tb_ic_flush_sparc
+#define tb_gen_superblock tb_gen_superblock_sparc
+#define translator_follow_jump translator_follow_jump_sparc
+#define translator_follow_branch translator_follow_branch_sparc
+#define tcg_gen_lookup_and_goto_ptr_ic tcg_gen_lookup_and_goto_ptr_ic_sparc
+#define tcg_gen_lookup_and_goto_ptr_ret tcg_gen_lookup_and_goto_ptr_ret_sparc
+#define tcg_gen_push_return tcg_gen_push_return_sparc
+#define helper_lookup_tb_ptr_ic helper_lookup_tb_ptr_ic_sparc
 #define tcg_flush_softmmu_tlb tcg_flush_softmmu_tlb_sparc
 #define translator_loop_temp_check translator_loop_temp_check_sparc
 #define translator_loop translator_loop_sparc
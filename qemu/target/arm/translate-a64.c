@@ -318,6 +318,8 @@ static void gen_step_complete_exception(DisasContext *s)
 static inline bool use_goto_tb(DisasContext *s, int n, uint64_t dest)
 {
     struct uc_struct *uc = s->uc;
+
+    translator_add_successor(uc->tcg_ctx, dest);
     /* No direct tb linking with singlestep (either QEMU's or the ARM
      * debug architecture kind) or deterministic io
      */
@@ -358,6 +360,56 @@ static inline void gen_goto_tb(DisasContext *s, int n, uint64_t dest)
     }
 }
 
+/* Unicorn: go on translating the superblock at @dest, within its page */
+static void gen_follow_to(DisasContext *s, uint64_t dest)
+{
+    struct uc_struct *uc = s->uc;
+    int bound = -(dest | TARGET_PAGE_MASK) / 4;
+
+    s->base.pc_next = dest;
+    s->base.max_insns = MIN(s->base.max_insns, s->base.num_insns + bound);
+}
+
+/* Unicorn: in a superblock, follow the direct jump to @dest if possible */
+static bool gen_follow_jump(DisasContext *s, uint64_t dest)
+{
+    if (s->base.singlestep_enabled || s->ss_active ||
+        !translator_follow_jump(s->uc->tcg_ctx, &s->base, s->base.pc_next,
+                                dest)) {
+        return false;
+    }
+    gen_follow_to(s, dest);
+    return true;
+}
+
+/*
+ * Unicorn: in a superblock, pick the side of a conditional branch to @addr
+ * to go on at, see translator_follow_branch().
+ */
+static int gen_follow_branch(DisasContext *s, uint64_t addr)
+{
+    if (s->base.singlestep_enabled || s->ss_active) {
+        return -1;
+    }
+    return translator_follow_branch(s->uc->tcg_ctx, &s->base,
+                                    s->base.pc_next, addr);
+}
+
+/*
+ * Unicorn: leave the superblock for @cold unless the branch to @label_hot
+ * was taken, and go on at @hot.
+ */
+static void gen_side_exit(DisasContext *s, TCGLabel *label_hot, uint64_t hot,
+                          uint64_t cold)
+{
+    TCGContext *tcg_ctx = s->uc->tcg_ctx;
+
+    gen_a64_set_pc_im(tcg_ctx, cold);
+    tcg_gen_lookup_and_goto_ptr(tcg_ctx);
+    gen_set_label(tcg_ctx, label_hot);
+    gen_follow_to(s, hot);
+}
+
 void unallocated_encoding(DisasContext *s)
 {
     /* Unallocated and reserved encodings are uncategorized */
@@ -1289,11 +1341,14 @@ static void disas_uncond_b_imm(DisasContext *s, uint32_t insn)
     if (insn & (1U << 31)) {
         /* BL Branch with link */
         tcg_gen_movi_i64(tcg_ctx, cpu_reg(s, 30), s->base.pc_next);
+        tcg_gen_push_return(tcg_ctx, s->base.tb, s->base.pc_next);
     }
 
     /* B Branch / BL Branch with link */
     reset_btype(s);
-    gen_goto_tb(s, 0, addr);
+    if ((insn & (1U << 31)) || !gen_follow_jump(s, addr)) {
+        gen_goto_tb(s, 0, addr);
+    }
 }
 
 /* Compare and branch (immediate)
@@ -1309,6 +1364,8 @@ static void disas_comp_b_imm(DisasContext *s, uint32_t insn)
     uint64_t addr;
     TCGLabel *label_match;
     TCGv_i64 tcg_cmp;
+    TCGCond cond;
+    int hot;
 
     sf = extract32(insn, 31, 1);
     op = extract32(insn, 24, 1); /* 0: CBZ; 1: CBNZ */
@@ -1317,10 +1374,18 @@ static void disas_comp_b_imm(DisasContext *s, uint32_t insn)
 
     tcg_cmp = read_cpu_reg(s, rt, sf);
     label_match = gen_new_label(tcg_ctx);
+    cond = op ? TCG_COND_NE : TCG_COND_EQ;
+    hot = gen_follow_branch(s, addr);
 
     reset_btype(s);
-    tcg_gen_brcondi_i64(tcg_ctx, op ? TCG_COND_NE : TCG_COND_EQ,
-                        tcg_cmp, 0, label_match);
+    if (hot >= 0) {
+        tcg_gen_brcondi_i64(tcg_ctx, hot ? cond : tcg_invert_cond(cond),
+                            tcg_cmp, 0, label_match);
+        gen_side_exit(s, label_match, hot ? addr : s->base.pc_next,
+                      hot ? s->base.pc_next : addr);
+        return;
+    }
+    tcg_gen_brcondi_i64(tcg_ctx, cond, tcg_cmp, 0, label_match);
 
     gen_goto_tb(s, 0, s->base.pc_next);
     gen_set_label(tcg_ctx, label_match);
@@ -1340,6 +1405,8 @@ static void disas_test_b_imm(DisasContext *s, uint32_t insn)
     uint64_t addr;
     TCGLabel *label_match;
     TCGv_i64 tcg_cmp;
+    TCGCond cond;
+    int hot;
 
     bit_pos = (extract32(insn, 31, 1) << 5) | extract32(insn, 19, 5);
     op = extract32(insn, 24, 1); /* 0: TBZ; 1: TBNZ */
@@ -1349,10 +1416,19 @@ static void disas_test_b_imm(DisasContext *s, uint32_t insn)
     tcg_cmp = tcg_temp_new_i64(tcg_ctx);
     tcg_gen_andi_i64(tcg_ctx, tcg_cmp, cpu_reg(s, rt), (1ULL << bit_pos));
     label_match = gen_new_label(tcg_ctx);
+    cond = op ? TCG_COND_NE : TCG_COND_EQ;
+    hot = gen_follow_branch(s, addr);
 
     reset_btype(s);
-    tcg_gen_brcondi_i64(tcg_ctx, op ? TCG_COND_NE : TCG_COND_EQ,
-                        tcg_cmp, 0, label_match);
+    if (hot >= 0) {
+        tcg_gen_brcondi_i64(tcg_ctx, hot ? cond : tcg_invert_cond(cond),
+                            tcg_cmp, 0, label_match);
+        tcg_temp_free_i64(tcg_ctx, tcg_cmp);
+        gen_side_exit(s, label_match, hot ? addr : s->base.pc_next,
+                      hot ? s->base.pc_next : addr);
+        return;
+    }
+    tcg_gen_brcondi_i64(tcg_ctx, cond, tcg_cmp, 0, label_match);
     tcg_temp_free_i64(tcg_ctx, tcg_cmp);
     gen_goto_tb(s, 0, s->base.pc_next);
     gen_set_label(tcg_ctx, label_match);
@@ -1382,11 +1458,19 @@ static void disas_cond_b_imm(DisasContext *s, uint32_t insn)
     if (cond < 0x0e) {
         /* genuinely conditional branches */
         TCGLabel *label_match = gen_new_label(tcg_ctx);
+        int hot = gen_follow_branch(s, addr);
+
+        if (hot >= 0) {
+            arm_gen_test_cc(tcg_ctx, hot ? cond : cond ^ 1, label_match);
+            gen_side_exit(s, label_match, hot ? addr : s->base.pc_next,
+                          hot ? s->base.pc_next : addr);
+            return;
+        }
         arm_gen_test_cc(tcg_ctx, cond, label_match);
         gen_goto_tb(s, 0, s->base.pc_next);
         gen_set_label(tcg_ctx, label_match);
         gen_goto_tb(s, 1, addr);
-    } else {
+    } else if (!gen_follow_jump(s, addr)) {
         /* 0xe and 0xf are both "always" conditions */
         gen_goto_tb(s, 0, addr);
     }
@@ -2210,7 +2294,9 @@ static void disas_uncond_b_reg(DisasContext *s, uint32_t insn)
         /* BLR also needs to load return address */
         if (opc == 1) {
             tcg_gen_movi_i64(tcg_ctx, cpu_reg(s, 30), s->base.pc_next);
+            tcg_gen_push_return(tcg_ctx, s->base.tb, s->base.pc_next);
         }
+        s->jmp_ret = opc == 2;
         break;
 
     case 8: /* BRAA */
@@ -2237,6 +2323,7 @@ static void disas_uncond_b_reg(DisasContext *s, uint32_t insn)
         /* BLRAA also needs to load return address */
         if (opc == 9) {
             tcg_gen_movi_i64(tcg_ctx, cpu_reg(s, 30), s->base.pc_next);
+            tcg_gen_push_return(tcg_ctx, s->base.tb, s->base.pc_next);
         }
         break;
 
@@ -14623,6 +14710,7 @@ static void aarch64_tr_init_disas_context(DisasContextBase *dcbase,
 
     // unicorn handle
     dc->uc = uc;
+    dc->jmp_ret = false;
     dc->isar = &arm_cpu->isar;
     dc->condjmp = 0;
 
@@ -14801,7 +14889,13 @@ static void aarch64_tr_tb_stop(DisasContextBase *dcbase, CPUState *cpu)
             tcg_gen_exit_tb(tcg_ctx, NULL, 0);
             break;
         case DISAS_JUMP:
-            tcg_gen_lookup_and_goto_ptr(tcg_ctx);
+            if (dc->jmp_ret) {
+                tcg_gen_lookup_and_goto_ptr_ret(tcg_ctx, dc->base.tb,
+                                                tcg_ctx->cpu_pc_arm64);
+            } else {
+                tcg_gen_lookup_and_goto_ptr_ic(tcg_ctx, dc->base.tb,
+                                               tcg_ctx->cpu_pc_arm64);
+            }
             break;
         case DISAS_NORETURN:
         case DISAS_SWI:
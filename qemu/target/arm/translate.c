@@ -2710,6 +2710,8 @@ static void gen_neon_dup_high16(TCGContext *tcg_ctx, TCGv_i32 var)
 static inline bool use_goto_tb(DisasContext *s, target_ulong dest)
 {
     struct uc_struct *uc = s->uc;
+
+    translator_add_successor(uc->tcg_ctx, dest);
     return (s->base.tb->pc & TARGET_PAGE_MASK) == (dest & TARGET_PAGE_MASK) ||
            ((s->base.pc_next - 1) & TARGET_PAGE_MASK) == (dest & TARGET_PAGE_MASK);
 }
@@ -2719,6 +2721,27 @@ static void gen_goto_ptr(TCGContext *tcg_ctx)
     tcg_gen_lookup_and_goto_ptr(tcg_ctx);
 }
 
+/*
+ * Unicorn: jump to the destination set by gen_bx() or store_reg(). Bit 0 of
+ * the cached destinations is the Thumb bit since it's part of the TB flags.
+ */
+static void gen_goto_ptr_ic(DisasContext *s)
+{
+    TCGContext *tcg_ctx = s->uc->tcg_ctx;
+    TCGv_i32 dest = load_cpu_field(tcg_ctx, thumb);
+    TCGv_i64 pc = tcg_temp_new_i64(tcg_ctx);
+
+    tcg_gen_or_i32(tcg_ctx, dest, dest, tcg_ctx->cpu_R[15]);
+    tcg_gen_extu_i32_i64(tcg_ctx, pc, dest);
+    if (s->jmp_ret) {
+        tcg_gen_lookup_and_goto_ptr_ret(tcg_ctx, s->base.tb, pc);
+    } else {
+        tcg_gen_lookup_and_goto_ptr_ic(tcg_ctx, s->base.tb, pc);
+    }
+    tcg_temp_free_i64(tcg_ctx, pc);
+    tcg_temp_free_i32(tcg_ctx, dest);
+}
+
 /* This will end the TB but doesn't guarantee we'll return to
  * cpu_loop_exec. Any live exit_requests will be processed as we
  * enter the next TB.
@@ -8720,6 +8743,7 @@ static bool trans_BX(DisasContext *s, arg_BX *a)
     if (!ENABLE_ARCH_4T) {
         return false;
     }
+    s->jmp_ret = a->rm == 14;
     gen_bx_excret(s, load_reg(s, a->rm));
     return true;
 }
@@ -8744,6 +8768,7 @@ static bool trans_BLX_r(DisasContext *s, arg_BLX_r *a)
     }
     tmp = load_reg(s, a->rm);
     tcg_gen_movi_i32(tcg_ctx, tcg_ctx->cpu_R[14], s->base.pc_next | s->thumb);
+    tcg_gen_push_return(tcg_ctx, s->base.tb, s->base.pc_next | s->thumb);
     gen_bx(s, tmp);
     return true;
 }
@@ -10444,6 +10469,9 @@ static bool do_ldm(DisasContext *s, arg_ldst_block *a, int min_n)
         return true;
     }
 
+    /* Unicorn: pop {..., pc} returns */
+    s->jmp_ret = a->rn == 13 && (list & (1 << 15));
+
     addr = op_addr_block_pre(s, a, n);
     mem_idx = get_mem_index(s);
     loaded_base = false;
@@ -10563,6 +10591,7 @@ static bool trans_BL(DisasContext *s, arg_i *a)
 {
     TCGContext *tcg_ctx = s->uc->tcg_ctx;
     tcg_gen_movi_i32(tcg_ctx, tcg_ctx->cpu_R[14], s->base.pc_next | s->thumb);
+    tcg_gen_push_return(tcg_ctx, s->base.tb, s->base.pc_next | s->thumb);
     gen_jmp(s, read_pc(s) + a->imm);
     return true;
 }
@@ -10577,6 +10606,7 @@ static bool trans_BLX_i(DisasContext *s, arg_BLX_i *a)
         return false;
     }
     tcg_gen_movi_i32(tcg_ctx, tcg_ctx->cpu_R[14], s->base.pc_next | s->thumb);
+    tcg_gen_push_return(tcg_ctx, s->base.tb, s->base.pc_next | s->thumb);
     tmp = tcg_const_i32(tcg_ctx, !s->thumb);
     store_cpu_field(tcg_ctx, tmp, thumb);
     gen_jmp(s, (read_pc(s) & ~3) + a->imm);
@@ -10599,6 +10629,7 @@ static bool trans_BL_suffix(DisasContext *s, arg_BL_suffix *a)
     assert(!arm_dc_feature(s, ARM_FEATURE_THUMB2));
     tcg_gen_addi_i32(tcg_ctx, tmp, tcg_ctx->cpu_R[14], (a->imm << 1) | 1);
     tcg_gen_movi_i32(tcg_ctx, tcg_ctx->cpu_R[14], s->base.pc_next | 1);
+    tcg_gen_push_return(tcg_ctx, s->base.tb, s->base.pc_next | 1);
     gen_bx(s, tmp);
     return true;
 }
@@ -10616,6 +10647,7 @@ static bool trans_BLX_suffix(DisasContext *s, arg_BLX_suffix *a)
     tcg_gen_addi_i32(tcg_ctx, tmp, tcg_ctx->cpu_R[14], a->imm << 1);
     tcg_gen_andi_i32(tcg_ctx, tmp, tmp, 0xfffffffc);
     tcg_gen_movi_i32(tcg_ctx, tcg_ctx->cpu_R[14], s->base.pc_next | 1);
+    tcg_gen_push_return(tcg_ctx, s->base.tb, s->base.pc_next | 1);
     gen_bx(s, tmp);
     return true;
 }
@@ -11238,6 +11270,7 @@ static void arm_tr_init_disas_context(DisasContextBase *dcbase, CPUState *cs)
 
     // unicorn handle
     dc->uc = uc;
+    dc->jmp_ret = false;
     dc->isar = &cpu->isar;
     dc->condjmp = 0;
 
@@ -11710,7 +11743,7 @@ static void arm_tr_tb_stop(DisasContextBase *dcbase, CPUState *cpu)
             gen_goto_tb(dc, 1, dc->base.pc_next);
             break;
         case DISAS_JUMP:
-            gen_goto_ptr(tcg_ctx);
+            gen_goto_ptr_ic(dc);
             break;
         case DISAS_UPDATE:
             gen_set_pc_im(dc, dc->base.pc_next);
@@ -97,6 +97,8 @@ typedef struct DisasContext {
 
     // Unicorn
     struct uc_struct *uc;
+    // The indirect jump ending the TB is a function return
+    bool jmp_ret;
 } DisasContext;
 
 typedef struct DisasCompare {
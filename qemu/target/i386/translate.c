@@ -2454,6 +2454,7 @@ static inline int insn_const_size(MemOp ot)
 
 static inline bool use_goto_tb(DisasContext *s, target_ulong pc)
 {
+    translator_add_successor(s->uc->tcg_ctx, pc);
     return (pc & TARGET_PAGE_MASK) == (s->base.tb->pc & TARGET_PAGE_MASK) ||
            (pc & TARGET_PAGE_MASK) == (s->pc_start & TARGET_PAGE_MASK);
 }
@@ -2476,13 +2477,45 @@ static inline void gen_goto_tb(DisasContext *s, int tb_num, target_ulong eip)
     }
 }
 
+/* Unicorn: whether a superblock may go on past the jump of this insn */
+static inline bool use_superblock(DisasContext *s)
+{
+    return s->jmp_opt && !(s->flags & HF_RF_MASK) &&
+           (tb_cflags(s->base.tb) & CF_SUPERBLOCK);
+}
+
+/* Unicorn: in a superblock, go on translating at @eip rather than jump */
+static bool gen_jmp_follow(DisasContext *s, target_ulong eip)
+{
+    if (!use_superblock(s) ||
+        !translator_follow_jump(s->uc->tcg_ctx, &s->base, s->pc,
+                                s->cs_base + eip)) {
+        return false;
+    }
+    s->pc = s->cs_base + eip;
+    return true;
+}
+
 static inline void gen_jcc(DisasContext *s, int b,
                            target_ulong val, target_ulong next_eip)
 {
     TCGContext *tcg_ctx = s->uc->tcg_ctx;
     TCGLabel *l1, *l2;
+    int hot = -1;
 
-    if (s->jmp_opt) {
+    if (use_superblock(s)) {
+        hot = translator_follow_branch(tcg_ctx, &s->base, s->pc,
+                                       s->cs_base + val);
+    }
+    if (hot >= 0) {
+        /* Unicorn: superblock, leave through a side exit on the cold side */
+        l1 = gen_new_label(tcg_ctx);
+        gen_jcc1(s, hot ? b : b ^ 1, l1);
+        gen_jmp_im(s, hot ? next_eip : val);
+        tcg_gen_lookup_and_goto_ptr(tcg_ctx);
+        gen_set_label(tcg_ctx, l1);
+        s->pc = s->cs_base + (hot ? val : next_eip);
+    } else if (s->jmp_opt) {
         l1 = gen_new_label(tcg_ctx);
         gen_jcc1(s, b, l1);
 
@@ -2829,8 +2862,17 @@ static void gen_bnd_jmp(DisasContext *s)
    If INHIBIT, set HF_INHIBIT_IRQ_MASK if it isn't already set.
    If RECHECK_TF, emit a rechecking helper for #DB, ignoring the state of
    S->TF.  This is used by the syscall/sysret insns.  */
+/* Unicorn: how the jump ending a TB finds the next one */
+enum {
+    JR_NONE,        /* return to the main loop */
+    JR_LOOKUP,      /* look the destination up */
+    JR_INDIRECT,    /* inline cache of the jump, then lookup */
+    JR_RETURN,      /* shadow stack, then as JR_INDIRECT */
+};
+
 static void
-do_gen_eob_worker(DisasContext *s, bool inhibit, bool recheck_tf, bool jr)
+do_gen_eob_worker(DisasContext *s, bool inhibit, bool recheck_tf, int jr,
+                  TCGv dest)
 {
     TCGContext *tcg_ctx = s->uc->tcg_ctx;
     gen_update_cc_op(s);
@@ -2852,6 +2894,16 @@ do_gen_eob_worker(DisasContext *s, bool inhibit, bool recheck_tf, bool jr)
         tcg_gen_exit_tb(tcg_ctx, NULL, 0);
     } else if (s->tf) {
         gen_helper_single_step(tcg_ctx, tcg_ctx->cpu_env);
+    } else if (jr == JR_INDIRECT || jr == JR_RETURN) {
+        TCGv_i64 pc = tcg_temp_new_i64(tcg_ctx);
+
+        tcg_gen_extu_tl_i64(tcg_ctx, pc, dest);
+        if (jr == JR_RETURN) {
+            tcg_gen_lookup_and_goto_ptr_ret(tcg_ctx, s->base.tb, pc);
+        } else {
+            tcg_gen_lookup_and_goto_ptr_ic(tcg_ctx, s->base.tb, pc);
+        }
+        tcg_temp_free_i64(tcg_ctx, pc);
     } else if (jr) {
         tcg_gen_lookup_and_goto_ptr(tcg_ctx);
     } else {
@@ -2863,7 +2915,7 @@ do_gen_eob_worker(DisasContext *s, bool inhibit, bool recheck_tf, bool jr)
 static inline void
 gen_eob_worker(DisasContext *s, bool inhibit, bool recheck_tf)
 {
-    do_gen_eob_worker(s, inhibit, recheck_tf, false);
+    do_gen_eob_worker(s, inhibit, recheck_tf, JR_NONE, NULL);
 }
 
 /* End of block.
@@ -2882,7 +2934,19 @@ static void gen_eob(DisasContext *s)
 /* Jump to register */
 static void gen_jr(DisasContext *s, TCGv dest)
 {
-    do_gen_eob_worker(s, false, false, true);
+    do_gen_eob_worker(s, false, false, JR_LOOKUP, dest);
+}
+
+/* Near indirect jump or call to register */
+static void gen_jr_ic(DisasContext *s, TCGv dest)
+{
+    do_gen_eob_worker(s, false, false, JR_INDIRECT, dest);
+}
+
+/* Near return to register */
+static void gen_jr_ret(DisasContext *s, TCGv dest)
+{
+    do_gen_eob_worker(s, false, false, JR_RETURN, dest);
 }
 
 /* generate a jump to eip. No segment change must happen before as a
@@ -5502,9 +5566,10 @@ static target_ulong disas_insn(DisasContext *s, CPUState *cpu)
             next_eip = s->pc - s->cs_base;
             tcg_gen_movi_tl(tcg_ctx, s->T1, next_eip);
             gen_push_v(s, s->T1);
+            tcg_gen_push_return(tcg_ctx, s->base.tb, next_eip);
             gen_op_jmp_v(tcg_ctx, s->T0);
             gen_bnd_jmp(s);
-            gen_jr(s, s->T0);
+            gen_jr_ic(s, s->T0);
             break;
         case 3: /* lcall Ev */
             if (mod == 3) {
@@ -5534,7 +5599,7 @@ static target_ulong disas_insn(DisasContext *s, CPUState *cpu)
             }
             gen_op_jmp_v(tcg_ctx, s->T0);
             gen_bnd_jmp(s);
-            gen_jr(s, s->T0);
+            gen_jr_ic(s, s->T0);
             break;
         case 5: /* ljmp Ev */
             if (mod == 3) {
@@ -7109,7 +7174,7 @@ static target_ulong disas_insn(DisasContext *s, CPUState *cpu)
         /* Note that gen_pop_T0 uses a zero-extending load.  */
         gen_op_jmp_v(tcg_ctx, s->T0);
         gen_bnd_jmp(s);
-        gen_jr(s, s->T0);
+        gen_jr_ret(s, s->T0);
         break;
     case 0xc3: /* ret */
         ot = gen_pop_T0(s);
@@ -7117,7 +7182,7 @@ static target_ulong disas_insn(DisasContext *s, CPUState *cpu)
         /* Note that gen_pop_T0 uses a zero-extending load.  */
         gen_op_jmp_v(tcg_ctx, s->T0);
         gen_bnd_jmp(s);
-        gen_jr(s, s->T0);
+        gen_jr_ret(s, s->T0);
         break;
     case 0xca: /* lret im */
         val = x86_ldsw_code(env, s);
@@ -7182,6 +7247,7 @@ static target_ulong disas_insn(DisasContext *s, CPUState *cpu)
             }
             tcg_gen_movi_tl(tcg_ctx, s->T0, next_eip);
             gen_push_v(s, s->T0);
+            tcg_gen_push_return(tcg_ctx, s->base.tb, next_eip);
             gen_bnd_jmp(s);
             gen_jmp(s, tval);
         }
@@ -7213,7 +7279,9 @@ static target_ulong disas_insn(DisasContext *s, CPUState *cpu)
             tval &= 0xffffffff;
         }
         gen_bnd_jmp(s);
-        gen_jmp(s, tval);
+        if (!gen_jmp_follow(s, tval)) {
+            gen_jmp(s, tval);
+        }
         break;
     case 0xea: /* ljmp im */
         {
@@ -7235,7 +7303,9 @@ static target_ulong disas_insn(DisasContext *s, CPUState *cpu)
         if (dflag == MO_16) {
             tval &= 0xffff;
         }
-        gen_jmp(s, tval);
+        if (!gen_jmp_follow(s, tval)) {
+            gen_jmp(s, tval);
+        }
         break;
     case 0x70: /* jcc Jb */
     case 0x71: /* jcc Jb */
@@ -9408,6 +9478,11 @@ static void i386_tr_translate_insn(DisasContextBase *dcbase, CPUState *cpu)
         dc->base.is_jmp = DISAS_TOO_MANY;
     } else if ((pc_next - dc->base.pc_first) >= (TARGET_PAGE_SIZE - 32)) {
         dc->base.is_jmp = DISAS_TOO_MANY;
+    } else if (dc->base.num_jumps &&
+               ((pc_next + TARGET_MAX_INSN_SIZE - 1) & TARGET_PAGE_MASK) !=
+               (dc->base.pc_first & TARGET_PAGE_MASK)) {
+        /* Unicorn: a superblock doesn't go on into the next page */
+        dc->base.is_jmp = DISAS_TOO_MANY;
     }
 
     dc->base.pc_next = pc_next;
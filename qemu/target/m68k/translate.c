@@ -1528,6 +1528,7 @@ static void gen_exit_tb(DisasContext *s)
 
 static inline bool use_goto_tb(DisasContext *s, uint32_t dest)
 {
+    translator_add_successor(s->uc->tcg_ctx, dest);
     return (s->base.pc_first & TARGET_PAGE_MASK) == (dest & TARGET_PAGE_MASK)
         || (s->base.pc_next & TARGET_PAGE_MASK) == (dest & TARGET_PAGE_MASK);
 }
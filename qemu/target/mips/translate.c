@@ -2526,6 +2526,8 @@ typedef struct DisasContext {
 
     // Unicorn
     struct uc_struct *uc;
+    // The pending jump to register is a function return
+    bool jmp_ret;
 } DisasContext;
 
 #define DISAS_STOP       DISAS_TARGET_0
@@ -5995,6 +5997,7 @@ static void gen_trap(DisasContext *ctx, uint32_t opc,
 
 static inline bool use_goto_tb(DisasContext *ctx, target_ulong dest)
 {
+    translator_add_successor(ctx->uc->tcg_ctx, dest);
     if (unlikely(ctx->base.singlestep_enabled)) {
         return false;
     }
@@ -6168,6 +6171,7 @@ static void gen_compute_branch(DisasContext *ctx, uint32_t opc,
             ctx->hflags |= MIPS_HFLAG_B;
             break;
         case OPC_JR:
+            ctx->jmp_ret = rs == 31;
             ctx->hflags |= MIPS_HFLAG_BR;
             break;
         case OPC_JALR:
@@ -6269,6 +6273,10 @@ static void gen_compute_branch(DisasContext *ctx, uint32_t opc,
 
         tcg_gen_movi_tl(tcg_ctx, tcg_ctx->cpu_gpr[blink],
                         ctx->base.pc_next + post_delay + lowbit);
+        if (!bcond_compute) {
+            tcg_gen_push_return(tcg_ctx, ctx->base.tb,
+                                ctx->base.pc_next + post_delay + lowbit);
+        }
     }
 
  out:
@@ -13167,7 +13175,19 @@ static void gen_branch(DisasContext *ctx, int insn_bytes)
                 save_cpu_state(ctx, 0);
                 gen_helper_raise_exception_debug(tcg_ctx, tcg_ctx->cpu_env);
             }
-            tcg_gen_lookup_and_goto_ptr(tcg_ctx);
+            {
+                /* the ISA mode bit of btarget selects the next TB too */
+                TCGv_i64 pc = tcg_temp_new_i64(tcg_ctx);
+
+                tcg_gen_extu_tl_i64(tcg_ctx, pc, tcg_ctx->btarget);
+                if (ctx->jmp_ret) {
+                    tcg_gen_lookup_and_goto_ptr_ret(tcg_ctx, ctx->base.tb, pc);
+                } else {
+                    tcg_gen_lookup_and_goto_ptr_ic(tcg_ctx, ctx->base.tb, pc);
+                }
+                tcg_temp_free_i64(tcg_ctx, pc);
+                ctx->jmp_ret = false;
+            }
             break;
         default:
             fprintf(stderr, "unknown branch 0x%x\n", proc_hflags);
@@ -30847,9 +30867,11 @@ static void mips_tr_init_disas_context(DisasContextBase *dcbase, CPUState *cs)
 {
     DisasContext *ctx = container_of(dcbase, DisasContext, base);
     CPUMIPSState *env = cs->env_ptr;
+    TCGContext *tcg_ctx = cs->uc->tcg_ctx;
 
     // unicorn setup
     ctx->uc = cs->uc;
+    ctx->jmp_ret = false;
 
     ctx->page_start = ctx->base.pc_first & TARGET_PAGE_MASK;
     ctx->saved_pc = -1;
@@ -30882,6 +30904,14 @@ static void mips_tr_init_disas_context(DisasContextBase *dcbase, CPUState *cs)
     ctx->mi = (env->CP0_Config5 >> CP0C5_MI) & 1;
     ctx->gi = (env->CP0_Config5 >> CP0C5_GI) & 3;
     restore_cpu_state(env, ctx);
+
+
+    // Unicorn: the TB prologue must not quit between a branch and its delay
+    // slot either, so the flag is set up before gen_tb_start()
+    tcg_ctx->delay_slot_flag = tcg_temp_local_new_i32(tcg_ctx);
+    tcg_gen_movi_i32(tcg_ctx, tcg_ctx->delay_slot_flag,
+                     (ctx->hflags & MIPS_HFLAG_BMASK) != 0);
+
     ctx->mem_idx = hflags_mmu_index(ctx->hflags);
     ctx->default_tcg_memop_mask = (ctx->insn_flags & ISA_MIPS32R6) ?
                                   MO_UNALN : MO_ALIGN;
@@ -30892,9 +30922,6 @@ static void mips_tr_init_disas_context(DisasContextBase *dcbase, CPUState *cs)
 
 static void mips_tr_tb_start(DisasContextBase *dcbase, CPUState *cs)
 {
-    DisasContext *ctx = container_of(dcbase, DisasContext, base);
-    TCGContext *tcg_ctx = ctx->uc->tcg_ctx;
-    tcg_ctx->delay_slot_flag = tcg_temp_local_new_i32(tcg_ctx);
 }
 
 static void mips_tr_insn_start(DisasContextBase *dcbase, CPUState *cs)
@@ -30951,6 +30978,7 @@ static void mips_tr_translate_insn(DisasContextBase *dcbase, CPUState *cs)
     dyn_is_slot = tcg_const_i32(tcg_ctx, 0);
     slot_op = tcg_last_op(tcg_ctx);
     tcg_gen_mov_i32(tcg_ctx, tcg_ctx->delay_slot_flag, dyn_is_slot);
+    tcg_temp_free_i32(tcg_ctx, dyn_is_slot);
 
     // Unicorn: trace this instruction on request
     if (HOOK_EXISTS_BOUNDED(uc, UC_HOOK_CODE, ctx->base.pc_next)) {
@@ -3806,6 +3806,7 @@ static inline void gen_update_cfar(DisasContext *ctx, target_ulong nip)
 
 static inline bool use_goto_tb(DisasContext *ctx, target_ulong dest)
 {
+    translator_add_successor(ctx->uc->tcg_ctx, dest);
     if (unlikely(ctx->singlestep_enabled)) {
         return false;
     }
@@ -70,8 +70,10 @@ static bool trans_jalr(DisasContext *ctx, arg_jalr *a)
 
     if (a->rd != 0) {
         tcg_gen_movi_tl(tcg_ctx, tcg_ctx->cpu_gpr[a->rd], ctx->pc_succ_insn);
+        tcg_gen_push_return(tcg_ctx, ctx->base.tb, ctx->pc_succ_insn);
     }
-    lookup_and_goto_ptr(ctx);
+    /* jalr x0, 0(ra) returns */
+    lookup_and_goto_ptr_ic(ctx, a->rd == 0 && a->rs1 == 1 && a->imm == 0);
 
     if (misaligned) {
         gen_set_label(tcg_ctx, misaligned);
@@ -142,6 +142,27 @@ static void lookup_and_goto_ptr(DisasContext *ctx)
     }
 }
 
+/* Like lookup_and_goto_ptr, with the inline caches of a JALR or a return */
+static void lookup_and_goto_ptr_ic(DisasContext *ctx, bool ret)
+{
+    TCGContext *tcg_ctx = ctx->uc->tcg_ctx;
+    TCGv_i64 pc;
+
+    if (ctx->base.singlestep_enabled) {
+        gen_exception_debug(tcg_ctx);
+        return;
+    }
+
+    pc = tcg_temp_new_i64(tcg_ctx);
+    tcg_gen_extu_tl_i64(tcg_ctx, pc, tcg_ctx->cpu_pc);
+    if (ret) {
+        tcg_gen_lookup_and_goto_ptr_ret(tcg_ctx, ctx->base.tb, pc);
+    } else {
+        tcg_gen_lookup_and_goto_ptr_ic(tcg_ctx, ctx->base.tb, pc);
+    }
+    tcg_temp_free_i64(tcg_ctx, pc);
+}
+
 static void gen_exception_illegal(DisasContext *ctx)
 {
     generate_exception(ctx, RISCV_EXCP_ILLEGAL_INST);
@@ -154,6 +175,7 @@ static void gen_exception_inst_addr_mis(DisasContext *ctx)
 
 static inline bool use_goto_tb(DisasContext *ctx, target_ulong dest)
 {
+    translator_add_successor(ctx->uc->tcg_ctx, dest);
     if (unlikely(ctx->base.singlestep_enabled)) {
         return false;
     }
@@ -342,6 +364,7 @@ static void gen_jal(DisasContext *ctx, int rd, target_ulong imm)
     }
     if (rd != 0) {
         tcg_gen_movi_tl(tcg_ctx, tcg_ctx->cpu_gpr[rd], ctx->pc_succ_insn);
+        tcg_gen_push_return(tcg_ctx, ctx->base.tb, ctx->pc_succ_insn);
     }
 
     gen_goto_tb(ctx, 0, ctx->base.pc_next + imm); /* must use this for safety */
@@ -709,6 +709,7 @@ static bool use_exit_tb(DisasContext *s)
 
 static bool use_goto_tb(DisasContext *s, uint64_t dest)
 {
+    translator_add_successor(s->uc->tcg_ctx, dest);
     if (unlikely(use_exit_tb(s))) {
         return false;
     }
@@ -327,6 +327,7 @@ static inline TCGv gen_dest_gpr(DisasContext *dc, int reg)
 static inline bool use_goto_tb(DisasContext *s, target_ulong pc,
                                target_ulong npc)
 {
+    translator_add_successor(s->uc->tcg_ctx, pc);
     // if (unlikely(s->base.singlestep_enabled || singlestep)) {
     if (unlikely(s->base.singlestep_enabled)) {
         return false;
@@ -3480,6 +3480,7 @@ static inline void gen_save_pc(DisasContext *ctx, target_ulong pc)
 
 static inline bool use_goto_tb(DisasContext *ctx, target_ulong dest)
 {
+    translator_add_successor(ctx->uc->tcg_ctx, dest);
     if (unlikely(ctx->base.singlestep_enabled)) {
         return false;
     }
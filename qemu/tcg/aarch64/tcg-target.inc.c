@@ -1587,8 +1587,7 @@ static bool tcg_out_qemu_ld_slow_path(TCGContext *s, TCGLabelQemuLdst *lb)
     MemOp opc = get_memop(oi);
     MemOp size = opc & MO_SIZE;
 
-    const int type = tcg_uc_has_hookmem(s) ? R_AARCH64_JUMP26 : R_AARCH64_CONDBR19;
-    if (!patch_reloc(lb->label_ptr[0], type, (intptr_t)s->code_ptr, 0)) {
+    if (!reloc_pc19(lb->label_ptr[0], s->code_ptr)) {
         return false;
     }
 
@@ -1613,8 +1612,7 @@ static bool tcg_out_qemu_st_slow_path(TCGContext *s, TCGLabelQemuLdst *lb)
     MemOp opc = get_memop(oi);
     MemOp size = opc & MO_SIZE;
 
-    const int type = tcg_uc_has_hookmem(s) ? R_AARCH64_JUMP26 : R_AARCH64_CONDBR19;
-    if (!patch_reloc(lb->label_ptr[0], type, (intptr_t)s->code_ptr, 0)) {
+    if (!reloc_pc19(lb->label_ptr[0], s->code_ptr)) {
         return false;
     }
 
@@ -1713,11 +1711,7 @@ static void tcg_out_tlb_read(TCGContext *s, TCGReg addr_reg, MemOp opc,
 
     /* If not equal, we jump to the slow path. */
     *label_ptr = s->code_ptr;
-    // Unicorn: fast path if hookmem is not enabled
-    if (!tcg_uc_has_hookmem(s))
-        tcg_out_insn(s, 3202, B_C, TCG_COND_NE, 0);
-    else
-        tcg_out_insn(s, 3206, B, 0);
+    tcg_out_insn(s, 3202, B_C, TCG_COND_NE, 0);
 }
 
 #endif /* CONFIG_SOFTMMU */
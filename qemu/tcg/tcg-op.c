@@ -2784,6 +2784,175 @@ void tcg_gen_lookup_and_goto_ptr(TCGContext *tcg_ctx)
 #endif
 }
 
+#if TCG_TARGET_HAS_goto_ptr
+/*
+ * Unicorn: inline caches are emitted only for the kinds enabled with
+ * UC_CTL_TB_INLINE_CACHE, and never into temporary TBs since the shadow
+ * stack may still point to them after they are freed.
+ */
+static bool tb_ic_enabled(TCGContext *tcg_ctx, TranslationBlock *tb, int kind)
+{
+    return (tcg_ctx->uc->tb_inline_cache & kind) &&
+           !(tb_cflags(tb) & CF_NOCACHE);
+}
+
+/*
+ * Jump to the TB cached by @ic if its key equals @pc and it's still valid.
+ * Both must be local temps, the probe branches.
+ */
+static void gen_ic_probe(TCGContext *tcg_ctx, TCGv_ptr ic, TCGv_i64 pc)
+{
+    TCGLabel *miss = gen_new_label(tcg_ctx);
+    TCGv_i64 key = tcg_temp_new_i64(tcg_ctx);
+    TCGv_i32 gen = tcg_temp_new_i32(tcg_ctx);
+    TCGv_i32 cur = tcg_temp_new_i32(tcg_ctx);
+    TCGv_ptr tb_ctx;
+    TCGv_ptr ptr;
+
+    tcg_gen_ld_i64(tcg_ctx, key, ic, offsetof(TBInlineCache, pc));
+    tcg_gen_brcond_i64(tcg_ctx, TCG_COND_NE, key, pc, miss);
+    tcg_temp_free_i64(tcg_ctx, key);
+
+    tcg_gen_ld_i32(tcg_ctx, gen, ic, offsetof(TBInlineCache, gen));
+    tb_ctx = tcg_const_ptr(tcg_ctx, &tcg_ctx->tb_ctx);
+    tcg_gen_ld_i32(tcg_ctx, cur, tb_ctx, offsetof(TBContext, ic_gen));
+    tcg_temp_free_ptr(tcg_ctx, tb_ctx);
+    tcg_gen_brcond_i32(tcg_ctx, TCG_COND_NE, gen, cur, miss);
+    tcg_temp_free_i32(tcg_ctx, gen);
+    tcg_temp_free_i32(tcg_ctx, cur);
+
+    ptr = tcg_temp_new_ptr(tcg_ctx);
+    tcg_gen_ld_ptr(tcg_ctx, ptr, ic, offsetof(TBInlineCache, ptr));
+    tcg_gen_op1i(tcg_ctx, INDEX_op_goto_ptr, tcgv_ptr_arg(tcg_ctx, ptr));
+    tcg_temp_free_ptr(tcg_ctx, ptr);
+
+    gen_set_label(tcg_ctx, miss);
+}
+
+/* Address of the shadow stack slot @top. */
+static TCGv_ptr gen_ret_stack_slot(TCGContext *tcg_ctx, TCGv_i32 top)
+{
+    TCGv_i32 off = tcg_temp_new_i32(tcg_ctx);
+    TCGv_ptr slot = tcg_temp_new_ptr(tcg_ctx);
+    TCGv_ptr base = tcg_const_ptr(tcg_ctx, &tcg_ctx->tb_ctx.ret_stack);
+
+    tcg_gen_shli_i32(tcg_ctx, off, top, ctz32(sizeof(void *)));
+    tcg_gen_ext_i32_ptr(tcg_ctx, slot, off);
+    tcg_gen_add_ptr(tcg_ctx, slot, slot, base);
+    tcg_temp_free_i32(tcg_ctx, off);
+    tcg_temp_free_ptr(tcg_ctx, base);
+    return slot;
+}
+
+static void gen_lookup_and_goto_ptr_ic(TCGContext *tcg_ctx,
+                                       TranslationBlock *tb, TCGv_i64 dest,
+                                       bool ret)
+{
+    TCGv_i64 pc = tcg_temp_local_new_i64(tcg_ctx);
+    TCGv_ptr ret_ic = NULL;
+    TCGv_ptr ic, ptr;
+    int i;
+
+    tcg_gen_mov_i64(tcg_ctx, pc, dest);
+
+    if (ret) {
+        TCGv_ptr tb_ctx = tcg_const_ptr(tcg_ctx, &tcg_ctx->tb_ctx);
+        TCGv_i32 top = tcg_temp_new_i32(tcg_ctx);
+        TCGv_ptr slot;
+
+        /* pop the return address cache of the matching call */
+        tcg_gen_ld_i32(tcg_ctx, top, tb_ctx, offsetof(TBContext, ret_top));
+        slot = gen_ret_stack_slot(tcg_ctx, top);
+        ret_ic = tcg_temp_local_new_ptr(tcg_ctx);
+        tcg_gen_ld_ptr(tcg_ctx, ret_ic, slot, 0);
+        tcg_gen_subi_i32(tcg_ctx, top, top, 1);
+        tcg_gen_andi_i32(tcg_ctx, top, top, TB_RET_STACK_SIZE - 1);
+        tcg_gen_st_i32(tcg_ctx, top, tb_ctx, offsetof(TBContext, ret_top));
+        tcg_temp_free_ptr(tcg_ctx, slot);
+        tcg_temp_free_i32(tcg_ctx, top);
+        tcg_temp_free_ptr(tcg_ctx, tb_ctx);
+
+        gen_ic_probe(tcg_ctx, ret_ic, pc);
+    }
+
+    if (tb_ic_enabled(tcg_ctx, tb, UC_TB_IC_INDIRECT)) {
+        for (i = 0; i < TB_IC_WAYS; i++) {
+            ic = tcg_const_local_ptr(tcg_ctx, &tb->ic[i]);
+            gen_ic_probe(tcg_ctx, ic, pc);
+            tcg_temp_free_ptr(tcg_ctx, ic);
+        }
+        ic = tcg_const_ptr(tcg_ctx, &tb->ic[0]);
+    } else {
+        ic = tcg_const_ptr(tcg_ctx, NULL);
+    }
+    if (!ret_ic) {
+        ret_ic = tcg_const_ptr(tcg_ctx, NULL);
+    }
+
+    ptr = tcg_temp_new_ptr(tcg_ctx);
+    gen_helper_lookup_tb_ptr_ic(tcg_ctx, ptr, tcg_ctx->cpu_env, ic, ret_ic, pc);
+    tcg_gen_op1i(tcg_ctx, INDEX_op_goto_ptr, tcgv_ptr_arg(tcg_ctx, ptr));
+    tcg_temp_free_ptr(tcg_ctx, ptr);
+    tcg_temp_free_ptr(tcg_ctx, ic);
+    tcg_temp_free_ptr(tcg_ctx, ret_ic);
+    tcg_temp_free_i64(tcg_ctx, pc);
+}
+#endif
+
+void tcg_gen_lookup_and_goto_ptr_ic(TCGContext *tcg_ctx, TranslationBlock *tb,
+                                    TCGv_i64 dest)
+{
+#if TCG_TARGET_HAS_goto_ptr
+    if (tb_ic_enabled(tcg_ctx, tb, UC_TB_IC_INDIRECT)) {
+        gen_lookup_and_goto_ptr_ic(tcg_ctx, tb, dest, false);
+        return;
+    }
+#endif
+    tcg_gen_lookup_and_goto_ptr(tcg_ctx);
+}
+
+void tcg_gen_lookup_and_goto_ptr_ret(TCGContext *tcg_ctx, TranslationBlock *tb,
+                                     TCGv_i64 dest)
+{
+#if TCG_TARGET_HAS_goto_ptr
+    if (tb_ic_enabled(tcg_ctx, tb, UC_TB_IC_RETURN)) {
+        gen_lookup_and_goto_ptr_ic(tcg_ctx, tb, dest, true);
+        return;
+    }
+#endif
+    tcg_gen_lookup_and_goto_ptr_ic(tcg_ctx, tb, dest);
+}
+
+void tcg_gen_push_return(TCGContext *tcg_ctx, TranslationBlock *tb,
+                         uint64_t ret)
+{
+#if TCG_TARGET_HAS_goto_ptr
+    TCGv_ptr tb_ctx, slot, ret_ic;
+    TCGv_i32 top;
+
+    if (!tb_ic_enabled(tcg_ctx, tb, UC_TB_IC_RETURN)) {
+        return;
+    }
+
+    /* filled by the return once it found its TB */
+    tb->ret_ic.pc = ret;
+
+    tb_ctx = tcg_const_ptr(tcg_ctx, &tcg_ctx->tb_ctx);
+    top = tcg_temp_new_i32(tcg_ctx);
+    tcg_gen_ld_i32(tcg_ctx, top, tb_ctx, offsetof(TBContext, ret_top));
+    tcg_gen_addi_i32(tcg_ctx, top, top, 1);
+    tcg_gen_andi_i32(tcg_ctx, top, top, TB_RET_STACK_SIZE - 1);
+    tcg_gen_st_i32(tcg_ctx, top, tb_ctx, offsetof(TBContext, ret_top));
+    slot = gen_ret_stack_slot(tcg_ctx, top);
+    ret_ic = tcg_const_ptr(tcg_ctx, &tb->ret_ic);
+    tcg_gen_st_ptr(tcg_ctx, ret_ic, slot, 0);
+    tcg_temp_free_ptr(tcg_ctx, ret_ic);
+    tcg_temp_free_ptr(tcg_ctx, slot);
+    tcg_temp_free_i32(tcg_ctx, top);
+    tcg_temp_free_ptr(tcg_ctx, tb_ctx);
+#endif
+}
+
 static inline MemOp tcg_canonicalize_memop(MemOp op, bool is64, bool st)
 {
     /* Trigger the asserts within as early as possible.  */
@@ -2861,13 +3030,15 @@ void check_exit_request(TCGContext *tcg_ctx)
 
     TCGv_ptr puc = tcg_const_ptr(tcg_ctx, tcg_ctx->uc);
     TCGv_i32 tmp = tcg_const_i32(tcg_ctx, 0);
+    TCGv_i32 icount = tcg_const_i32(tcg_ctx, 0);
     // Unicorn:
     //    We CANT'T use brcondi_i32 here or we will fail liveness analysis
     //    because it marks the end of BB
     if (tcg_ctx->delay_slot_flag != NULL) {
         tcg_gen_mov_i32(tcg_ctx, tmp, tcg_ctx->delay_slot_flag);
     }
-    gen_helper_check_exit_request(tcg_ctx, puc, tmp);
+    gen_helper_check_exit_request(tcg_ctx, puc, tmp, icount);
+    tcg_temp_free_i32(tcg_ctx, icount);
     tcg_temp_free_i32(tcg_ctx, tmp);
     tcg_temp_free_ptr(tcg_ctx, puc);
 }
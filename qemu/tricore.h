@@ -127,10 +127,16 @@
 #define memory_map_io memory_map_io_tricore
 #define memory_map_ptr memory_map_ptr_tricore
 #define memory_cow memory_cow_tricore
+#define memory_page_saved memory_page_saved_tricore
+#define memory_restore_pages memory_restore_pages_tricore
 #define memory_unmap memory_unmap_tricore
 #define memory_moveout memory_moveout_tricore
 #define memory_movein memory_movein_tricore
 #define memory_free memory_free_tricore
+#define memory_reset memory_reset_tricore
+#define memory_unmap_batch memory_unmap_batch_tricore
+#define memory_transaction_begin memory_transaction_begin_tricore
+#define memory_transaction_commit memory_transaction_commit_tricore
 #define flatview_unref flatview_unref_tricore
 #define address_space_get_flatview address_space_get_flatview_tricore
 #define memory_region_transaction_begin memory_region_transaction_begin_tricore
@@ -1273,6 +1279,15 @@
 #define tb_check_watchpoint tb_check_watchpoint_tricore
 #define cpu_io_recompile cpu_io_recompile_tricore
 #define tb_flush_jmp_cache tb_flush_jmp_cache_tricore
+#define tb_flush_cross_page_jumps tb_flush_cross_page_jumps_tricore
+#define tb_ic_flush tb_ic_flush_tricore
+#define tb_gen_superblock tb_gen_superblock_tricore
+#define translator_follow_jump translator_follow_jump_tricore
+#define translator_follow_branch translator_follow_branch_tricore
+#define tcg_gen_lookup_and_goto_ptr_ic tcg_gen_lookup_and_goto_ptr_ic_tricore
+#define tcg_gen_lookup_and_goto_ptr_ret tcg_gen_lookup_and_goto_ptr_ret_tricore
+#define tcg_gen_push_return tcg_gen_push_return_tricore
+#define helper_lookup_tb_ptr_ic helper_lookup_tb_ptr_ic_tricore
 #define tcg_flush_softmmu_tlb tcg_flush_softmmu_tlb_tricore
 #define translator_loop_temp_check translator_loop_temp_check_tricore
 #define translator_loop translator_loop_tricore
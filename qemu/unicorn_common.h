@@ -199,6 +199,11 @@ static inline void uc_common_init(struct uc_struct* uc)
     uc->memory_unmap = memory_unmap;
     uc->memory_moveout = memory_moveout;
     uc->memory_movein = memory_movein;
+    uc->memory_restore_pages = memory_restore_pages;
+    uc->memory_reset = memory_reset;
+    uc->memory_unmap_batch = memory_unmap_batch;
+    uc->memory_transaction_begin = memory_transaction_begin;
+    uc->memory_transaction_commit = memory_transaction_commit;
     uc->readonly_mem = memory_region_set_readonly;
     uc->target_page = target_page_init;
     uc->softfloat_initialize = softfloat_init;
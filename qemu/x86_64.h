@@ -127,10 +127,16 @@
 #define memory_map_io memory_map_io_x86_64
 #define memory_map_ptr memory_map_ptr_x86_64
 #define memory_cow memory_cow_x86_64
+#define memory_page_saved memory_page_saved_x86_64
+#define memory_restore_pages memory_restore_pages_x86_64
 #define memory_unmap memory_unmap_x86_64
 #define memory_moveout memory_moveout_x86_64
 #define memory_movein memory_movein_x86_64
 #define memory_free memory_free_x86_64
+#define memory_reset memory_reset_x86_64
+#define memory_unmap_batch memory_unmap_batch_x86_64
+#define memory_transaction_begin memory_transaction_begin_x86_64
+#define memory_transaction_commit memory_transaction_commit_x86_64
 #define flatview_unref flatview_unref_x86_64
 #define address_space_get_flatview address_space_get_flatview_x86_64
 #define memory_region_transaction_begin memory_region_transaction_begin_x86_64
@@ -1273,6 +1279,15 @@
 #define tb_check_watchpoint tb_check_watchpoint_x86_64
 #define cpu_io_recompile cpu_io_recompile_x86_64
 #define tb_flush_jmp_cache tb_flush_jmp_cache_x86_64
+#define tb_flush_cross_page_jumps tb_flush_cross_page_jumps_x86_64
+#define tb_ic_flush tb_ic_flush_x86_64
+#define tb_gen_superblock tb_gen_superblock_x86_64
+#define translator_follow_jump translator_follow_jump_x86_64
+#define translator_follow_branch translator_follow_branch_x86_64
+#define tcg_gen_lookup_and_goto_ptr_ic tcg_gen_lookup_and_goto_ptr_ic_x86_64
+#define tcg_gen_lookup_and_goto_ptr_ret tcg_gen_lookup_and_goto_ptr_ret_x86_64
+#define tcg_gen_push_return tcg_gen_push_return_x86_64
+#define helper_lookup_tb_ptr_ic helper_lookup_tb_ptr_ic_x86_64
 #define tcg_flush_softmmu_tlb tcg_flush_softmmu_tlb_x86_64
 #define translator_loop_temp_check translator_loop_temp_check_x86_64
 #define translator_loop translator_loop_x86_64
@@ -127,10 +127,16 @@ memory_map \
 memory_map_io \
 memory_map_ptr \
 memory_cow \
+memory_page_saved \
+memory_restore_pages \
 memory_unmap \
 memory_moveout \
 memory_movein \
 memory_free \
+memory_reset \
+memory_unmap_batch \
+memory_transaction_begin \
+memory_transaction_commit \
 flatview_unref \
 address_space_get_flatview \
 memory_region_transaction_begin \
@@ -1273,6 +1279,15 @@ tb_invalidate_phys_page_fast \
 tb_check_watchpoint \
 cpu_io_recompile \
 tb_flush_jmp_cache \
+tb_flush_cross_page_jumps \
+tb_ic_flush \
+tb_gen_superblock \
+translator_follow_jump \
+translator_follow_branch \
+tcg_gen_lookup_and_goto_ptr_ic \
+tcg_gen_lookup_and_goto_ptr_ret \
+tcg_gen_push_return \
+helper_lookup_tb_ptr_ic \
 tcg_flush_softmmu_tlb \
 translator_loop_temp_check \
 translator_loop \
@@ -0,0 +1,90 @@
+#include <unicorn/unicorn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/*
+ * A loop of two blocks: the head counts down and jumps to the body, the body
+ * jumps back to the head. With the body at 0x1800 both blocks sit in one page,
+ * at 0x1ffe the body spans two pages. Both layouts should run at about the
+ * same speed now that jumps into blocks spanning two pages are chained.
+ */
+
+static uint64_t CODEADDR = 0x1000;
+static uint64_t EXITADDR = 0x1f00;
+static uint32_t NLOOPS = 20000000;
+
+static size_t put_jmp(uint8_t *p, const uint8_t *op, size_t oplen,
+                      uint64_t from, uint64_t to)
+{
+    int32_t rel = (int32_t)(to - (from + oplen + 4));
+
+    memcpy(p, op, oplen);
+    memcpy(p + oplen, &rel, 4);
+    return oplen + 4;
+}
+
+static double run(uint64_t body)
+{
+    uc_engine *uc;
+    uc_err err;
+    uint8_t code[0x10];
+    size_t n = 0;
+    uint32_t ecx = NLOOPS;
+    struct timespec start, end;
+
+    uc_open(UC_ARCH_X86, UC_MODE_32, &uc);
+    uc_mem_map(uc, CODEADDR, 0x2000, UC_PROT_ALL);
+
+    // dec ecx; jz EXITADDR; jmp body
+    code[n++] = 0x49;
+    n += put_jmp(code + n, (const uint8_t *)"\x0f\x84", 2, CODEADDR + n,
+                 EXITADDR);
+    n += put_jmp(code + n, (const uint8_t *)"\xe9", 1, CODEADDR + n, body);
+    uc_mem_write(uc, CODEADDR, code, n);
+
+    // nop * 4; jmp CODEADDR
+    n = 0;
+    memset(code, 0x90, 4);
+    n += 4;
+    n += put_jmp(code + n, (const uint8_t *)"\xe9", 1, body + n, CODEADDR);
+    uc_mem_write(uc, body, code, n);
+
+    uc_reg_write(uc, UC_X86_REG_ECX, &ecx);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    err = uc_emu_start(uc, CODEADDR, EXITADDR, 0, 0);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    if (err != UC_ERR_OK) {
+        printf("err: %s\n", uc_strerror(err));
+        exit(1);
+    }
+
+    uc_close(uc);
+
+    return ((end.tv_sec - start.tv_sec) * 1e9 +
+            (end.tv_nsec - start.tv_nsec)) /
+           NLOOPS;
+}
+
+int main(int argc, char *argv[])
+{
+    double same, cross;
+
+    if (argc == 2) {
+        NLOOPS = strtoul(argv[1], NULL, 0);
+    } else if (argc != 1) {
+        fprintf(stderr, "usage: %s [loops]\n", argv[0]);
+        return 1;
+    }
+
+    same = run(0x1800);
+    cross = run(0x1ffe);
+
+    printf("body in one page:   %.2f ns per loop\n", same);
+    printf("body across pages:  %.2f ns per loop\n", cross);
+    printf("ratio:              %.2f\n", cross / same);
+
+    return 0;
+}
@@ -5,6 +5,7 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <string.h>
 
 struct data {
     gsl_rstat_workspace *rstat_p;
@@ -145,9 +146,14 @@ int main(int argc, char *argv[])
     uint64_t rax = 5;
     uint64_t rbx = DATABASE;
     void *bin_mmap = NULL;
+    int snapshot_mode = UC_SNAPSHOT_REGION;
+    gsl_rstat_workspace *restore_rstat_p;
+    struct timespec start, end;
 
-    if (argc != 2) {
-        fprintf(stderr, "usage: %s binary\n", argv[0]);
+    if (argc == 3 && !strcmp(argv[2], "page")) {
+        snapshot_mode = UC_SNAPSHOT_PAGE;
+    } else if (argc != 2 && !(argc == 3 && !strcmp(argv[2], "region"))) {
+        fprintf(stderr, "usage: %s binary [region|page]\n", argv[0]);
         return 1;
     }
 
@@ -158,6 +164,7 @@ int main(int argc, char *argv[])
 
     uc_open(UC_ARCH_X86, UC_MODE_64, &uc);
     uc_ctl_context_mode(uc, UC_CTL_CONTEXT_MEMORY);
+    uc_ctl_snapshot_mode(uc, snapshot_mode);
     uc_ctl_tlb_mode(uc, UC_TLB_VIRTUAL);
     prepare_code(uc, argv[1], &bin_mmap);
     prepare_mapping(uc);
@@ -183,5 +190,21 @@ int main(int argc, char *argv[])
         d.nc++;
     }
     print_stats(d.rstat_p);
+
+    // restore the snapshots newest first, each drops one level of dirty pages
+    restore_rstat_p = gsl_rstat_alloc();
+    while (d.nc > 0) {
+        d.nc--;
+        clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &start);
+        err = uc_context_restore(uc, d.c[d.nc]);
+        clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &end);
+        if (err) {
+            printf("err: %s\n", uc_strerror(err));
+            return 1;
+        }
+        update_stats(restore_rstat_p, &start, &end);
+    }
+    printf("\nrestore:\n");
+    print_stats(restore_rstat_p);
     return 0;
 }
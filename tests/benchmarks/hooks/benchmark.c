@@ -0,0 +1,78 @@
+#include <unicorn/unicorn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/*
+ * A loop run with a growing number of code hooks, the way a fuzzer runs a
+ * coverage hook next to a tracing one. Every hook covering an instruction is
+ * called directly from the translated code.
+ */
+
+static uint64_t CODEADDR = 0x1000;
+static uint32_t NLOOPS = 2000000;
+
+// mov ecx, NLOOPS; xor eax, eax
+// loop: inc eax; add edx, eax; dec ecx; jnz loop
+static const uint8_t CODE[] = {0xb9, 0x00, 0x00, 0x00, 0x00, 0x31, 0xc0, 0x40,
+                               0x01, 0xc2, 0x49, 0x75, 0xfa};
+
+static void hook_code(uc_engine *uc, uint64_t address, uint32_t size,
+                      void *user_data)
+{
+    (*(uint64_t *)user_data)++;
+}
+
+static double run(int nhooks)
+{
+    uc_engine *uc;
+    uc_err err;
+    uc_hook hh;
+    uint8_t code[sizeof(CODE)];
+    uint64_t calls = 0;
+    struct timespec start, end;
+    int i;
+
+    memcpy(code, CODE, sizeof(code));
+    memcpy(code + 1, &NLOOPS, 4);
+
+    uc_open(UC_ARCH_X86, UC_MODE_32, &uc);
+    uc_mem_map(uc, CODEADDR, 0x1000, UC_PROT_ALL);
+    uc_mem_write(uc, CODEADDR, code, sizeof(code));
+    for (i = 0; i < nhooks; i++) {
+        uc_hook_add(uc, &hh, UC_HOOK_CODE, hook_code, &calls, 1, 0);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    err = uc_emu_start(uc, CODEADDR, CODEADDR + sizeof(code), 0, 0);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    if (err != UC_ERR_OK) {
+        printf("err: %s\n", uc_strerror(err));
+        exit(1);
+    }
+
+    uc_close(uc);
+
+    return ((end.tv_sec - start.tv_sec) * 1e9 +
+            (end.tv_nsec - start.tv_nsec)) /
+           NLOOPS;
+}
+
+int main(int argc, char *argv[])
+{
+    int i;
+
+    if (argc == 2) {
+        NLOOPS = strtoul(argv[1], NULL, 0);
+    } else if (argc != 1) {
+        fprintf(stderr, "usage: %s [loops]\n", argv[0]);
+        return 1;
+    }
+
+    for (i = 0; i <= 3; i++) {
+        printf("%d code hooks:  %.2f ns per loop\n", i, run(i));
+    }
+
+    return 0;
+}
@@ -0,0 +1,74 @@
+#include <unicorn/unicorn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/*
+ * A loop whose body takes a rarely false branch and a forward jump, so that
+ * every iteration runs through three TBs. With UC_CTL_TB_SUPERBLOCK the hot
+ * path is retranslated into one superblock and the rare side leaves it.
+ */
+
+static uint64_t CODEADDR = 0x1000;
+static uint32_t NLOOPS = 20000000;
+
+// mov ecx, NLOOPS; xor eax, eax; xor ebx, ebx
+// loop: inc eax; test cl, 0x3f; jnz skip; add ebx, 1
+// skip: add eax, ebx; jmp next; int3
+// next: dec ecx; jnz loop
+static const uint8_t CODE[] = {
+    0xb9, 0x00, 0x00, 0x00, 0x00, 0x31, 0xc0, 0x31, 0xdb, 0x40, 0xf6,
+    0xc1, 0x3f, 0x75, 0x03, 0x83, 0xc3, 0x01, 0x01, 0xd8, 0xeb, 0x01,
+    0xcc, 0x49, 0x75, 0xef};
+
+static double run(uint32_t threshold)
+{
+    uc_engine *uc;
+    uc_err err;
+    uint8_t code[sizeof(CODE)];
+    struct timespec start, end;
+
+    memcpy(code, CODE, sizeof(code));
+    memcpy(code + 1, &NLOOPS, 4);
+
+    uc_open(UC_ARCH_X86, UC_MODE_32, &uc);
+    uc_mem_map(uc, CODEADDR, 0x1000, UC_PROT_ALL);
+    uc_mem_write(uc, CODEADDR, code, sizeof(code));
+    uc_ctl_tb_superblock(uc, threshold);
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    err = uc_emu_start(uc, CODEADDR, CODEADDR + sizeof(code), 0, 0);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    if (err != UC_ERR_OK) {
+        printf("err: %s\n", uc_strerror(err));
+        exit(1);
+    }
+
+    uc_close(uc);
+
+    return ((end.tv_sec - start.tv_sec) * 1e9 +
+            (end.tv_nsec - start.tv_nsec)) /
+           NLOOPS;
+}
+
+int main(int argc, char *argv[])
+{
+    double tbs, superblocks;
+
+    if (argc == 2) {
+        NLOOPS = strtoul(argv[1], NULL, 0);
+    } else if (argc != 1) {
+        fprintf(stderr, "usage: %s [loops]\n", argv[0]);
+        return 1;
+    }
+
+    tbs = run(0);
+    superblocks = run(1000);
+
+    printf("TBs:          %.2f ns per loop\n", tbs);
+    printf("superblocks:  %.2f ns per loop\n", superblocks);
+    printf("speedup:      %.2f\n", tbs / superblocks);
+
+    return 0;
+}
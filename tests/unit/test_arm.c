@@ -1032,6 +1032,38 @@ static void test_arm_svc_hvc_syndrome(void)
     OK(uc_close(uc));
 }
 
+static void test_arm_inline_cache(void)
+{
+    uc_engine *uc;
+    // mov r5, #0x1100; orr r5, r5, #1; mov r6, #0x1200; mov r4, #10
+    // loop: blx r5; blx r6; subs r4, r4, #1; bne loop
+    char code[] = "\x11\x5c\xa0\xe3\x01\x50\x85\xe3\x12\x6c\xa0\xe3\x0a\x40\xa0"
+                  "\xe3\x35\xff\x2f\xe1\x36\xff\x2f\xe1\x01\x40\x54\xe2\xfb\xff"
+                  "\xff\x1a";
+    // adds r0, #1; bx lr (Thumb)
+    char f1[] = "\x01\x30\x70\x47";
+    // add r1, r1, #2; bx lr
+    char f2[] = "\x02\x10\x81\xe2\x1e\xff\x2f\xe1";
+    int r_r0 = 0, r_r1 = 0, r_pc;
+
+    uc_common_setup(&uc, UC_ARCH_ARM, UC_MODE_ARM, code, sizeof(code) - 1,
+                    UC_CPU_ARM_CORTEX_A15);
+    OK(uc_ctl_tb_inline_cache(uc, UC_TB_IC_INDIRECT | UC_TB_IC_RETURN));
+    OK(uc_mem_write(uc, 0x1100, f1, sizeof(f1) - 1));
+    OK(uc_mem_write(uc, 0x1200, f2, sizeof(f2) - 1));
+
+    OK(uc_emu_start(uc, code_start, code_start + sizeof(code) - 1, 0, 0));
+
+    OK(uc_reg_read(uc, UC_ARM_REG_R0, &r_r0));
+    OK(uc_reg_read(uc, UC_ARM_REG_R1, &r_r1));
+    OK(uc_reg_read(uc, UC_ARM_REG_PC, &r_pc));
+    TEST_CHECK(r_r0 == 10);
+    TEST_CHECK(r_r1 == 20);
+    TEST_CHECK(r_pc == code_start + sizeof(code) - 1);
+
+    OK(uc_close(uc));
+}
+
 TEST_LIST = {{"test_arm_nop", test_arm_nop},
              {"test_arm_thumb_sub", test_arm_thumb_sub},
              {"test_armeb_sub", test_armeb_sub},
@@ -1063,4 +1095,5 @@ TEST_LIST = {{"test_arm_nop", test_arm_nop},
              {"test_arm_cp15_c1_c0_2", test_arm_cp15_c1_c0_2},
              {"test_arm_v7_lpae", test_arm_v7_lpae},
              {"test_arm_svc_hvc_syndrome", test_arm_svc_hvc_syndrome},
+             {"test_arm_inline_cache", test_arm_inline_cache},
              {NULL, NULL}};
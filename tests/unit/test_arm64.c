@@ -665,6 +665,95 @@ static void test_arm64_pc_guarantee(void)
     OK(uc_close(uc));
 }
 
+static void test_arm64_mem_hook_page_cb(uc_engine *uc, uc_mem_type type,
+                                        uint64_t address, int size,
+                                        int64_t value, void *user_data)
+{
+    (*(int *)user_data)++;
+}
+
+static void test_arm64_mem_hook_page_alignment(void)
+{
+    uc_engine *uc;
+    uc_hook hk;
+    int reads = 0;
+    // ldr x3, [x4]; ldr x5, [x6]
+    const char code_ldr[] = "\x83\x00\x40\xf9\xc5\x00\x40\xf9";
+    // ldr x3, [x4]; ldxp x1, x2, [x0]
+    const char code_ldxp[] = "\x83\x00\x40\xf9\x01\x08\x7f\xc8";
+    uint64_t r_x0 = 0x10008;
+    uint64_t r_x4 = 0x10000;
+    uint64_t r_x6 = 0x11000;
+
+    uc_common_setup(&uc, UC_ARCH_ARM64, UC_MODE_ARM, code_ldr,
+                    sizeof(code_ldr) - 1, UC_CPU_ARM64_A72);
+    OK(uc_mem_map(uc, 0x10000, 0x2000, UC_PROT_ALL));
+    OK(uc_reg_write(uc, UC_ARM64_REG_X0, &r_x0));
+    OK(uc_reg_write(uc, UC_ARM64_REG_X4, &r_x4));
+    OK(uc_reg_write(uc, UC_ARM64_REG_X6, &r_x6));
+
+    // Warm up the TLB without any memory hook.
+    OK(uc_emu_start(uc, code_start, code_start + sizeof(code_ldr) - 1, 0, 0));
+
+    // Only the hooked page leaves the inline fast path.
+    OK(uc_hook_add(uc, &hk, UC_HOOK_MEM_READ, test_arm64_mem_hook_page_cb,
+                   &reads, 0x10000, 0x10fff));
+    OK(uc_emu_start(uc, code_start, code_start + sizeof(code_ldr) - 1, 0, 0));
+    TEST_CHECK(reads == 1);
+
+    // A misaligned exclusive pair load on the hooked page must still fault,
+    // the hook flag must not be mistaken for alignment bits.
+    OK(uc_mem_write(uc, code_start, code_ldxp, sizeof(code_ldxp) - 1));
+    uc_assert_err(UC_ERR_EXCEPTION,
+                  uc_emu_start(uc, code_start,
+                               code_start + sizeof(code_ldxp) - 1, 0, 0));
+    TEST_CHECK(reads == 2);
+
+    OK(uc_close(uc));
+}
+
+static void test_arm64_superblock(void)
+{
+    uc_engine *uc;
+    // mov x0, #1000; mov x1, #0; mov x2, #0
+    // loop: add x1, x1, #1; tst x0, #7; b.ne skip; add x2, x2, #1
+    // skip: b next; brk #0
+    // next: subs x0, x0, #1; b.ne loop
+    char code[] = "\x00\x7d\x80\xd2\x01\x00\x80\xd2\x02\x00\x80\xd2\x21\x04\x00"
+                  "\x91\x1f\x08\x40\xf2\x41\x00\x00\x54\x42\x04\x00\x91\x02\x00"
+                  "\x00\x14\x00\x00\x20\xd4\x00\x04\x00\xf1\x21\xff\xff\x54";
+    uint64_t r_x0, r_x1, r_x2, r_pc;
+    int i;
+
+    uc_common_setup(&uc, UC_ARCH_ARM64, UC_MODE_ARM, code, sizeof(code) - 1,
+                    UC_CPU_ARM64_A72);
+    OK(uc_ctl_tb_superblock(uc, 10));
+
+    // The second run starts with the superblocks built by the first one.
+    for (i = 0; i < 2; i++) {
+        OK(uc_emu_start(uc, code_start, code_start + sizeof(code) - 1, 0, 0));
+        OK(uc_reg_read(uc, UC_ARM64_REG_X0, &r_x0));
+        OK(uc_reg_read(uc, UC_ARM64_REG_X1, &r_x1));
+        OK(uc_reg_read(uc, UC_ARM64_REG_X2, &r_x2));
+        TEST_CHECK(r_x0 == 0);
+        TEST_CHECK(r_x1 == 1000);
+        TEST_CHECK(r_x2 == 125);
+    }
+
+    // 3 + 7 for the first iteration, then add and tst of the second.
+    OK(uc_emu_start(uc, code_start, code_start + sizeof(code) - 1, 0, 12));
+    OK(uc_reg_read(uc, UC_ARM64_REG_X0, &r_x0));
+    OK(uc_reg_read(uc, UC_ARM64_REG_X1, &r_x1));
+    OK(uc_reg_read(uc, UC_ARM64_REG_X2, &r_x2));
+    OK(uc_reg_read(uc, UC_ARM64_REG_PC, &r_pc));
+    TEST_CHECK(r_x0 == 999);
+    TEST_CHECK(r_x1 == 2);
+    TEST_CHECK(r_x2 == 1);
+    TEST_CHECK(r_pc == code_start + 0x14);
+
+    OK(uc_close(uc));
+}
+
 TEST_LIST = {{"test_arm64_until", test_arm64_until},
              {"test_arm64_code_patching", test_arm64_code_patching},
              {"test_arm64_code_patching_count", test_arm64_code_patching_count},
@@ -683,4 +772,7 @@ TEST_LIST = {{"test_arm64_until", test_arm64_until},
              {"test_arm64_mem_prot_regress", test_arm64_mem_prot_regress},
              {"test_arm64_mem_hook_read_write", test_arm64_mem_hook_read_write},
              {"test_arm64_pc_guarantee", test_arm64_pc_guarantee},
+             {"test_arm64_mem_hook_page_alignment",
+              test_arm64_mem_hook_page_alignment},
+             {"test_arm64_superblock", test_arm64_superblock},
              {NULL, NULL}};
@@ -175,6 +175,83 @@ static void test_uc_ctl_tb_cache(void)
     OK(uc_close(uc));
 }
 
+static void test_uc_ctl_tb_cache_batch(void)
+{
+    uc_engine *uc;
+    // inc ecx; jz 1f; inc edx; inc edx; 1: inc ebx; hlt
+    char code[] = "\x41\x74\x02\x42\x42\x43\xf4";
+    uint64_t addrs[] = {code_start, 0x100000};
+    size_t generated = 0, used = 0;
+    int r_edx = 0;
+
+    uc_common_setup(&uc, UC_ARCH_X86, UC_MODE_32, code, sizeof(code) - 1);
+
+    // The unmapped address is skipped.
+    OK(uc_ctl_request_cache_batch(uc, addrs, 2, 0, 0, &generated, &used));
+    TEST_CHECK(generated == 1);
+    TEST_CHECK(used > 0);
+
+    // Cached blocks are not translated again.
+    OK(uc_ctl_request_cache_batch(uc, addrs, 1, 0, 0, &generated, &used));
+    TEST_CHECK(generated == 0);
+    TEST_CHECK(used == 0);
+    OK(uc_close(uc));
+
+    // Both sides of the branch are followed.
+    uc_common_setup(&uc, UC_ARCH_X86, UC_MODE_32, code, sizeof(code) - 1);
+    OK(uc_ctl_request_cache_batch(uc, addrs, 1, 2, 0, &generated, NULL));
+    TEST_CHECK(generated == 3);
+    OK(uc_emu_start(uc, code_start, code_start + sizeof(code) - 2, 0, 0));
+    OK(uc_reg_read(uc, UC_X86_REG_EDX, &r_edx));
+    TEST_CHECK(r_edx == 2);
+    OK(uc_close(uc));
+
+    // The budget is exhausted by the first block.
+    uc_common_setup(&uc, UC_ARCH_X86, UC_MODE_32, code, sizeof(code) - 1);
+    OK(uc_ctl_request_cache_batch(uc, addrs, 1, 2, 1, &generated, NULL));
+    TEST_CHECK(generated == 1);
+    OK(uc_close(uc));
+}
+
+static void test_uc_ctl_tb_cache_export(void)
+{
+    uc_engine *uc;
+    // inc ecx; inc edx; jmp 1f; 1: inc ecx
+    char code[] = "\x41\x42\xeb\x00\x41";
+    const char *path = "test_uc_ctl_tb_cache_export.bin";
+    size_t count = 0;
+    int r_ecx = 0;
+
+    uc_common_setup(&uc, UC_ARCH_X86, UC_MODE_32, code, sizeof(code) - 1);
+    OK(uc_emu_start(uc, code_start, code_start + sizeof(code) - 1, 0, 0));
+    OK(uc_ctl_tb_cache_export(uc, path));
+    OK(uc_close(uc));
+
+    // The first block is translated ahead of emulation in a new engine, the
+    // one before the exit was dropped when the previous emulation ended.
+    uc_common_setup(&uc, UC_ARCH_X86, UC_MODE_32, code, sizeof(code) - 1);
+    OK(uc_ctl_tb_cache_import(uc, path, &count));
+    TEST_CHECK(count == 1);
+    OK(uc_emu_start(uc, code_start, code_start + sizeof(code) - 1, 0, 0));
+    OK(uc_reg_read(uc, UC_X86_REG_ECX, &r_ecx));
+    TEST_CHECK(r_ecx == 2);
+    OK(uc_close(uc));
+
+    // The code differs, nothing is loaded.
+    code[0] = '\x49';
+    uc_common_setup(&uc, UC_ARCH_X86, UC_MODE_32, code, sizeof(code) - 1);
+    OK(uc_ctl_tb_cache_import(uc, path, &count));
+    TEST_CHECK(count == 0);
+    OK(uc_close(uc));
+
+    // A cache of another mode is refused.
+    uc_common_setup(&uc, UC_ARCH_X86, UC_MODE_64, code, sizeof(code) - 1);
+    uc_assert_err(UC_ERR_ARG, uc_ctl_tb_cache_import(uc, path, NULL));
+    OK(uc_close(uc));
+
+    remove(path);
+}
+
 // Test requires UC_ARCH_ARM.
 #ifdef UNICORN_HAS_ARM
 static void test_uc_ctl_change_page_size(void)
@@ -398,6 +475,70 @@ static void test_noexec(void)
     OK(uc_close(uc));
 }
 
+typedef struct {
+    uint64_t blocks[64];
+    int nblocks;
+} CoverageLog;
+
+static void test_uc_ctl_coverage_block(uc_engine *uc, uint64_t address,
+                                       uint32_t size, void *user_data)
+{
+    CoverageLog *log = user_data;
+
+    if (log->nblocks < 64) {
+        log->blocks[log->nblocks++] = address;
+    }
+}
+
+static void test_uc_ctl_coverage_bitmap(void)
+{
+    uc_engine *uc;
+    // mov ecx, 10; loop: test cl, 1; jz even; inc eax; even: dec ecx; jnz loop
+    char code[] = "\xb9\x0a\x00\x00\x00\xf6\xc1\x01\x74\x01\x40\x49\x75\xf7";
+    static uint8_t map[256], expected[256];
+    CoverageLog log = {{0}, 0};
+    uint8_t *rmap;
+    size_t rsize;
+    uint32_t prev = 0, cur;
+    uc_hook h;
+    int i;
+
+    uc_common_setup(&uc, UC_ARCH_X86, UC_MODE_32, code, sizeof(code) - 1);
+    OK(uc_ctl_get_coverage_bitmap(uc, &rmap, &rsize));
+    TEST_CHECK(rmap == NULL && rsize == 0);
+    uc_assert_err(UC_ERR_ARG, uc_ctl_coverage_bitmap(uc, map, 100));
+    OK(uc_ctl_coverage_bitmap(uc, map, sizeof(map)));
+    OK(uc_ctl_get_coverage_bitmap(uc, &rmap, &rsize));
+    TEST_CHECK(rmap == map && rsize == sizeof(map));
+
+    // The block hook only records the path the bitmap should describe.
+    OK(uc_hook_add(uc, &h, UC_HOOK_BLOCK, test_uc_ctl_coverage_block, &log, 1,
+                   0));
+    OK(uc_emu_start(uc, code_start, code_start + sizeof(code) - 1, 0, 0));
+    OK(uc_hook_del(uc, h));
+    TEST_CHECK(log.nblocks == 16);
+    for (i = 0; i < log.nblocks; i++) {
+        cur = ((log.blocks[i] >> 4) ^ (log.blocks[i] << 8)) & (sizeof(map) - 1);
+        expected[prev ^ cur]++;
+        prev = cur >> 1;
+    }
+    TEST_CHECK(memcmp(map, expected, sizeof(map)) == 0);
+
+    // Chained TBs without any hook count the same edges.
+    memset(map, 0, sizeof(map));
+    OK(uc_emu_start(uc, code_start, code_start + sizeof(code) - 1, 0, 0));
+    TEST_CHECK(memcmp(map, expected, sizeof(map)) == 0);
+
+    memset(map, 0, sizeof(map));
+    OK(uc_ctl_coverage_bitmap(uc, NULL, 0));
+    OK(uc_emu_start(uc, code_start, code_start + sizeof(code) - 1, 0, 0));
+    for (i = 0; i < sizeof(map); i++) {
+        TEST_CHECK(map[i] == 0);
+    }
+
+    OK(uc_close(uc));
+}
+
 TEST_LIST = {
     {"test_uc_ctl_mode", test_uc_ctl_mode},
     {"test_uc_ctl_page_size", test_uc_ctl_page_size},
@@ -405,6 +546,8 @@ TEST_LIST = {
     {"test_uc_ctl_time_out", test_uc_ctl_time_out},
     {"test_uc_ctl_exits", test_uc_ctl_exits},
     {"test_uc_ctl_tb_cache", test_uc_ctl_tb_cache},
+    {"test_uc_ctl_tb_cache_batch", test_uc_ctl_tb_cache_batch},
+    {"test_uc_ctl_tb_cache_export", test_uc_ctl_tb_cache_export},
 #ifdef UNICORN_HAS_ARM
     {"test_uc_ctl_change_page_size", test_uc_ctl_change_page_size},
     {"test_uc_ctl_arm_cpu", test_uc_ctl_arm_cpu},
@@ -416,4 +559,5 @@ TEST_LIST = {
     {"test_uc_emu_stop_set_ip", test_uc_emu_stop_set_ip},
     {"test_tlb_clear", test_tlb_clear},
     {"test_noexec", test_noexec},
+    {"test_uc_ctl_coverage_bitmap", test_uc_ctl_coverage_bitmap},
     {NULL, NULL}};
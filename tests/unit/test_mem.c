@@ -60,6 +60,128 @@ static void test_mem_protect(void)
     OK(uc_close(qc));
 }
 
+static void test_mem_protect_page(void)
+{
+    uc_engine *uc;
+    // mov [0x3000], eax; mov [0x4000], eax
+    char code[] = "\xa3\x00\x30\x00\x00\xa3\x00\x40\x00\x00";
+    int r_eax = 0x12345678;
+    uc_mem_region *regions;
+    uint32_t count;
+    uint32_t mem;
+
+    OK(uc_open(UC_ARCH_X86, UC_MODE_32, &uc));
+    OK(uc_mem_map(uc, 0x1000, 0x8000, UC_PROT_ALL));
+    OK(uc_mem_write(uc, 0x1000, code, sizeof(code) - 1));
+    OK(uc_reg_write(uc, UC_X86_REG_EAX, &r_eax));
+
+    // Write protect a single page in the middle of the block.
+    OK(uc_mem_protect(uc, 0x4000, 0x1000, UC_PROT_READ));
+    OK(uc_mem_regions(uc, &regions, &count));
+    TEST_CHECK(count == 3);
+    TEST_CHECK(regions[0].begin == 0x1000 && regions[0].end == 0x3fff);
+    TEST_CHECK(regions[1].begin == 0x4000 && regions[1].end == 0x4fff);
+    TEST_CHECK(regions[1].perms == UC_PROT_READ);
+    TEST_CHECK(regions[2].begin == 0x5000 && regions[2].end == 0x8fff);
+    TEST_CHECK(regions[2].perms == UC_PROT_ALL);
+    OK(uc_free(regions));
+
+    uc_assert_err(UC_ERR_WRITE_PROT,
+                  uc_emu_start(uc, 0x1000, 0x1000 + sizeof(code) - 1, 0, 0));
+    OK(uc_mem_read(uc, 0x3000, &mem, sizeof(mem)));
+    TEST_CHECK(LEINT32(mem) == 0x12345678);
+    OK(uc_mem_read(uc, 0x4000, &mem, sizeof(mem)));
+    TEST_CHECK(mem == 0);
+
+    // Splitting the block keeps the permissions of its pages.
+    OK(uc_mem_unmap(uc, 0x7000, 0x1000));
+    OK(uc_mem_regions(uc, &regions, &count));
+    TEST_CHECK(count == 4);
+    TEST_CHECK(regions[1].begin == 0x4000 && regions[1].end == 0x4fff);
+    TEST_CHECK(regions[1].perms == UC_PROT_READ);
+    OK(uc_free(regions));
+
+    OK(uc_mem_protect(uc, 0x1000, 0x6000, UC_PROT_ALL));
+    OK(uc_mem_regions(uc, &regions, &count));
+    TEST_CHECK(count == 2);
+    OK(uc_free(regions));
+
+    OK(uc_emu_start(uc, 0x1000, 0x1000 + sizeof(code) - 1, 0, 0));
+    OK(uc_mem_read(uc, 0x4000, &mem, sizeof(mem)));
+    TEST_CHECK(LEINT32(mem) == 0x12345678);
+
+    OK(uc_close(uc));
+}
+
+static void test_mem_map_batch(void)
+{
+    uc_engine *uc;
+    uc_mem_region map[64];
+    uc_mem_region bad[2];
+    uc_mem_region *regions;
+    uint32_t count, i;
+    // inc ecx
+    char code[] = "\x41";
+    int r_ecx = 0;
+    uint8_t byte;
+
+    OK(uc_open(UC_ARCH_X86, UC_MODE_32, &uc));
+
+    // Every other page, in reverse order.
+    for (i = 0; i < 64; i++) {
+        map[i].begin = 0x100000 - i * 0x2000;
+        map[i].end = map[i].begin + 0xfff;
+        map[i].perms = UC_PROT_ALL;
+    }
+    map[63].end += 0x1000;
+
+    // Nothing is mapped if a single region is wrong.
+    bad[0] = map[0];
+    bad[1] = map[0];
+    bad[1].begin += 0x1000;
+    uc_assert_err(UC_ERR_ARG, uc_mem_map_batch(uc, bad, 2));
+    OK(uc_mem_map(uc, 0x1000, 0x1000, UC_PROT_ALL));
+    bad[0] = map[62];
+    map[62].begin = 0x1000;
+    map[62].end = 0x1fff;
+    uc_assert_err(UC_ERR_MAP, uc_mem_map_batch(uc, map, 64));
+    OK(uc_mem_regions(uc, &regions, &count));
+    TEST_CHECK(count == 1);
+    OK(uc_free(regions));
+    OK(uc_mem_unmap(uc, 0x1000, 0x1000));
+    map[62] = bad[0];
+
+    OK(uc_mem_map_batch(uc, map, 64));
+    OK(uc_mem_regions(uc, &regions, &count));
+    TEST_CHECK(count == 64);
+    for (i = 0; i < count; i++) {
+        TEST_CHECK(regions[i].begin == map[63 - i].begin);
+        TEST_CHECK(regions[i].end == map[63 - i].end);
+    }
+    OK(uc_free(regions));
+
+    OK(uc_mem_write(uc, map[10].begin, code, sizeof(code) - 1));
+    OK(uc_emu_start(uc, map[10].begin, map[10].begin + sizeof(code) - 1, 0,
+                    0));
+    OK(uc_reg_read(uc, UC_X86_REG_ECX, &r_ecx));
+    TEST_CHECK(r_ecx == 1);
+
+    // Whole regions and a part of the two page region at the bottom.
+    map[1] = map[63];
+    map[1].begin += 0x1000;
+    OK(uc_mem_unmap_batch(uc, map, 32));
+    OK(uc_mem_regions(uc, &regions, &count));
+    TEST_CHECK(count == 33);
+    TEST_CHECK(regions[0].begin == map[63].begin);
+    TEST_CHECK(regions[0].end == map[63].begin + 0xfff);
+    OK(uc_free(regions));
+    uc_assert_err(UC_ERR_READ_UNMAPPED,
+                  uc_mem_read(uc, map[10].begin, &byte, 1));
+    OK(uc_mem_read(uc, map[40].begin, &byte, 1));
+
+    OK(uc_close(uc));
+}
+
 static void test_splitting_mem_unmap(void)
 {
     uc_engine *uc;
@@ -318,6 +440,72 @@ static void test_snapshot(void)
     OK(uc_close(uc));
 }
 
+static void test_snapshot_page(void)
+{
+    uc_engine *uc;
+    uc_context *c0, *c1;
+    uc_mem_region *regions;
+    uint32_t count;
+    uint32_t mem;
+    int mode;
+    // mov eax, [0x2020]; inc eax; mov [0x2020], eax
+    char code[] = "\xa1\x20\x20\x00\x00\x00\x00\x00\x00\xff\xc0\xa3\x20\x20\x00"
+                  "\x00\x00\x00\x00\x00";
+
+    OK(uc_open(UC_ARCH_X86, UC_MODE_64, &uc));
+    OK(uc_context_alloc(uc, &c0));
+    OK(uc_context_alloc(uc, &c1));
+    OK(uc_ctl_context_mode(uc, UC_CTL_CONTEXT_MEMORY));
+    OK(uc_ctl_snapshot_mode(uc, UC_SNAPSHOT_PAGE));
+    OK(uc_ctl_get_snapshot_mode(uc, &mode));
+    TEST_CHECK(mode == UC_SNAPSHOT_PAGE);
+    OK(uc_mem_map(uc, 0x1000, 0x1000, UC_PROT_ALL));
+    OK(uc_mem_write(uc, 0x1000, code, sizeof(code) - 1));
+
+    OK(uc_mem_map(uc, 0x2000, 0x1000, UC_PROT_ALL));
+    OK(uc_context_save(uc, c0));
+    // the backend can't be switched while a snapshot is active
+    uc_assert_err(UC_ERR_ARG, uc_ctl_snapshot_mode(uc, UC_SNAPSHOT_REGION));
+
+    OK(uc_emu_start(uc, 0x1000, 0x1000 + sizeof(code) - 1, 0, 0));
+    OK(uc_mem_read(uc, 0x2020, &mem, sizeof(mem)));
+    TEST_CHECK(LEINT32(mem) == 1);
+    OK(uc_context_save(uc, c1));
+    OK(uc_emu_start(uc, 0x1000, 0x1000 + sizeof(code) - 1, 0, 0));
+    OK(uc_emu_start(uc, 0x1000, 0x1000 + sizeof(code) - 1, 0, 0));
+    OK(uc_mem_read(uc, 0x2020, &mem, sizeof(mem)));
+    TEST_CHECK(LEINT32(mem) == 3);
+
+    // dirtied pages are written in place, the layout stays the same
+    OK(uc_mem_regions(uc, &regions, &count));
+    TEST_CHECK(count == 2);
+    OK(uc_free(regions));
+
+    OK(uc_context_restore(uc, c1));
+    OK(uc_mem_read(uc, 0x2020, &mem, sizeof(mem)));
+    TEST_CHECK(LEINT32(mem) == 1);
+
+    // patch out the inc, restoring c0 must bring the original code back
+    mem = 0xffffffff;
+    OK(uc_mem_write(uc, 0x2020, &mem, sizeof(mem)));
+    OK(uc_mem_write(uc, 0x1009, "\x90\x90", 2));
+    OK(uc_emu_start(uc, 0x1000, 0x1000 + sizeof(code) - 1, 0, 0));
+    OK(uc_mem_read(uc, 0x2020, &mem, sizeof(mem)));
+    TEST_CHECK(mem == 0xffffffff);
+
+    OK(uc_context_restore(uc, c0));
+    OK(uc_mem_read(uc, 0x2020, &mem, sizeof(mem)));
+    TEST_CHECK(LEINT32(mem) == 0);
+    // the cached translation of the patched code must be gone
+    OK(uc_emu_start(uc, 0x1000, 0x1000 + sizeof(code) - 1, 0, 0));
+    OK(uc_mem_read(uc, 0x2020, &mem, sizeof(mem)));
+    TEST_CHECK(LEINT32(mem) == 1);
+
+    OK(uc_context_free(c0));
+    OK(uc_context_free(c1));
+    OK(uc_close(uc));
+}
+
 static bool test_snapshot_with_vtlb_callback(uc_engine *uc, uint64_t addr,
                                              uc_mem_type type,
                                              uc_tlb_entry *result,
@@ -589,9 +777,204 @@ static void test_virtual_write(void)
     OK(uc_close(uc));
 }
 
+typedef struct _mem_hook_page_count {
+    int reads;
+    int writes;
+    uint64_t last_addr;
+} mem_hook_page_count;
+
+static uint64_t test_mem_read_write_mmio_read_cb(struct uc_struct *uc,
+                                                 uint64_t addr, unsigned size,
+                                                 void *user_data)
+{
+    return 0x4141414141414141ULL;
+}
+
+static void test_mem_read_write_mmio_write_cb(struct uc_struct *uc,
+                                              uint64_t addr, unsigned size,
+                                              uint64_t data, void *user_data)
+{
+    *(uint64_t *)user_data += size;
+}
+
+static void test_mem_read_write_blocks(void)
+{
+    uc_engine *uc;
+    uint8_t buf[0x10];
+    uint8_t data[0x10] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16};
+    uint64_t written = 0;
+    int i;
+
+    OK(uc_open(UC_ARCH_X86, UC_MODE_64, &uc));
+    OK(uc_mem_map(uc, 0x1000, 0x1000, UC_PROT_ALL));
+    OK(uc_mem_map(uc, 0x2000, 0x1000, UC_PROT_READ));
+    OK(uc_mmio_map(uc, 0x3000, 0x1000, test_mem_read_write_mmio_read_cb, NULL,
+                   test_mem_read_write_mmio_write_cb, &written));
+
+    // Inside a single block, including a read-only one.
+    OK(uc_mem_write(uc, 0x1100, data, sizeof(data)));
+    OK(uc_mem_read(uc, 0x1100, buf, sizeof(buf)));
+    TEST_CHECK(memcmp(buf, data, sizeof(data)) == 0);
+    OK(uc_mem_write(uc, 0x2100, data, sizeof(data)));
+    OK(uc_mem_read(uc, 0x2100, buf, sizeof(buf)));
+    TEST_CHECK(memcmp(buf, data, sizeof(data)) == 0);
+
+    // Across two RAM blocks and across RAM and MMIO.
+    OK(uc_mem_write(uc, 0x1ff8, data, sizeof(data)));
+    OK(uc_mem_read(uc, 0x1ff8, buf, sizeof(buf)));
+    TEST_CHECK(memcmp(buf, data, sizeof(data)) == 0);
+    OK(uc_mem_write(uc, 0x2ff8, data, sizeof(data)));
+    TEST_CHECK(written == 8);
+    OK(uc_mem_read(uc, 0x2ff8, buf, sizeof(buf)));
+    TEST_CHECK(memcmp(buf, data, 8) == 0);
+    for (i = 8; i < 16; i++) {
+        TEST_CHECK(buf[i] == 0x41);
+    }
+
+    // Nothing is written if the area isn't fully mapped.
+    uc_assert_err(UC_ERR_WRITE_UNMAPPED,
+                  uc_mem_write(uc, 0xff8, data, sizeof(data)));
+    uc_assert_err(UC_ERR_READ_UNMAPPED,
+                  uc_mem_read(uc, 0x3ff8, buf, sizeof(buf)));
+
+    // The cached block must not outlive its mapping.
+    OK(uc_mem_read(uc, 0x1100, buf, sizeof(buf)));
+    OK(uc_mem_unmap(uc, 0x1000, 0x1000));
+    uc_assert_err(UC_ERR_READ_UNMAPPED,
+                  uc_mem_read(uc, 0x1100, buf, sizeof(buf)));
+    OK(uc_mem_map(uc, 0x1000, 0x1000, UC_PROT_ALL));
+    OK(uc_mem_read(uc, 0x1100, buf, sizeof(buf)));
+    for (i = 0; i < 16; i++) {
+        TEST_CHECK(buf[i] == 0);
+    }
+
+    OK(uc_close(uc));
+}
+
+static void test_mem_batch(void)
+{
+    uc_engine *uc;
+    uc_hook hook;
+    uint32_t in[3] = {0x11111111, 0x22222222, 0x33333333};
+    uint32_t out[3] = {0};
+    uint64_t addrs[3] = {0x1000, 0x1ffe, 0x5000};
+    size_t sizes[3] = {4, 4, 4};
+    const void *wbufs[3] = {&in[0], &in[1], &in[2]};
+    void *rbufs[3] = {&out[0], &out[1], &out[2]};
+    uint64_t vaddrs[2] = {0x2000, 0x2ffe};
+    uc_err errs[3];
+
+    OK(uc_open(UC_ARCH_X86, UC_MODE_64, &uc));
+    OK(uc_mem_map(uc, 0x1000, 0x2000, UC_PROT_READ));
+
+    // Every entry is tried, the first failure is returned.
+    uc_assert_err(UC_ERR_WRITE_UNMAPPED,
+                  uc_mem_write_batch(uc, addrs, wbufs, sizes, errs, 3));
+    TEST_CHECK(errs[0] == UC_ERR_OK);
+    TEST_CHECK(errs[1] == UC_ERR_OK);
+    TEST_CHECK(errs[2] == UC_ERR_WRITE_UNMAPPED);
+    uc_assert_err(UC_ERR_READ_UNMAPPED,
+                  uc_mem_read_batch(uc, addrs, rbufs, sizes, NULL, 3));
+    TEST_CHECK(out[0] == in[0]);
+    TEST_CHECK(out[1] == in[1]);
+    TEST_CHECK(out[2] == 0);
+
+    // The virtual variants, 0x2000 is mapped to 0x1000.
+    OK(uc_ctl_tlb_mode(uc, UC_TLB_VIRTUAL));
+    OK(uc_hook_add(uc, &hook, UC_HOOK_TLB_FILL, test_virtual_write_tlb_fill,
+                   NULL, 1, 0));
+    OK(uc_vmem_write_batch(uc, vaddrs, UC_PROT_READ, &wbufs[1], sizes, errs,
+                           2));
+    TEST_CHECK(errs[0] == UC_ERR_OK && errs[1] == UC_ERR_OK);
+    memset(out, 0, sizeof(out));
+    OK(uc_vmem_read_batch(uc, vaddrs, UC_PROT_READ, rbufs, sizes, errs, 2));
+    TEST_CHECK(out[0] == in[1]);
+    TEST_CHECK(out[1] == in[2]);
+
+    OK(uc_close(uc));
+}
+
+static void test_mem_hook_page_cb(uc_engine *uc, uc_mem_type type,
+                                  uint64_t address, int size, int64_t value,
+                                  void *user_data)
+{
+    mem_hook_page_count *cnt = (mem_hook_page_count *)user_data;
+
+    if (type == UC_MEM_READ) {
+        cnt->reads++;
+    } else if (type == UC_MEM_WRITE) {
+        cnt->writes++;
+    }
+    cnt->last_addr = address;
+}
+
+static void test_mem_hook_page_bounded(void)
+{
+    uc_engine *uc;
+    uc_hook h_read, h_write;
+    mem_hook_page_count cnt = {0};
+    uint32_t r_eax = 0x11223344;
+    uint32_t r_ebx = 0x55667788;
+    uint32_t mem;
+    /*
+     * mov eax, [0x2000]
+     * mov ebx, [0x3000]
+     * mov [0x2004], eax
+     * mov [0x3004], ebx
+     */
+    char code[] = {0xa1, 0x00, 0x20, 0x00, 0x00, 0x8b, 0x1d, 0x00,
+                   0x30, 0x00, 0x00, 0xa3, 0x04, 0x20, 0x00, 0x00,
+                   0x89, 0x1d, 0x04, 0x30, 0x00, 0x00};
+
+    OK(uc_open(UC_ARCH_X86, UC_MODE_32, &uc));
+    OK(uc_mem_map(uc, 0x1000, 0x3000, UC_PROT_ALL));
+    OK(uc_mem_write(uc, 0x1000, code, sizeof(code)));
+    OK(uc_mem_write(uc, 0x2000, &r_eax, sizeof(r_eax)));
+    OK(uc_mem_write(uc, 0x3000, &r_ebx, sizeof(r_ebx)));
+
+    // Warm up the TLB and the translated code without any memory hook.
+    OK(uc_emu_start(uc, 0x1000, 0x1000 + sizeof(code), 0, 0));
+
+    // Hooks installed afterwards must still fire, but only on their page.
+    OK(uc_hook_add(uc, &h_read, UC_HOOK_MEM_READ, test_mem_hook_page_cb, &cnt,
+                   0x3000, 0x3fff));
+    OK(uc_hook_add(uc, &h_write, UC_HOOK_MEM_WRITE, test_mem_hook_page_cb,
+                   &cnt, 0x3000, 0x3fff));
+    OK(uc_emu_start(uc, 0x1000, 0x1000 + sizeof(code), 0, 0));
+
+    TEST_CHECK(cnt.reads == 1);
+    TEST_CHECK(cnt.writes == 1);
+    TEST_CHECK(cnt.last_addr == 0x3004);
+
+    OK(uc_hook_del(uc, h_read));
+    OK(uc_hook_del(uc, h_write));
+    OK(uc_emu_start(uc, 0x1000, 0x1000 + sizeof(code), 0, 0));
+
+    TEST_CHECK(cnt.reads == 1);
+    TEST_CHECK(cnt.writes == 1);
+
+    // A hook that doesn't cover the start of its page still tags the page.
+    OK(uc_hook_add(uc, &h_write, UC_HOOK_MEM_WRITE, test_mem_hook_page_cb,
+                   &cnt, 0x2004, 0x2004));
+    OK(uc_emu_start(uc, 0x1000, 0x1000 + sizeof(code), 0, 0));
+
+    TEST_CHECK(cnt.reads == 1);
+    TEST_CHECK(cnt.writes == 2);
+    TEST_CHECK(cnt.last_addr == 0x2004);
+
+    OK(uc_mem_read(uc, 0x2004, &mem, sizeof(mem)));
+    TEST_CHECK(mem == r_eax);
+    OK(uc_mem_read(uc, 0x3004, &mem, sizeof(mem)));
+    TEST_CHECK(mem == r_ebx);
+
+    OK(uc_close(uc));
+}
+
 TEST_LIST = {{"test_map_correct", test_map_correct},
              {"test_map_wrapping", test_map_wrapping},
              {"test_mem_protect", test_mem_protect},
+             {"test_mem_protect_page", test_mem_protect_page},
+             {"test_mem_map_batch", test_mem_map_batch},
              {"test_splitting_mem_unmap", test_splitting_mem_unmap},
              {"test_splitting_mmio_unmap", test_splitting_mmio_unmap},
              {"test_mem_protect_map_ptr", test_mem_protect_map_ptr},
@@ -601,6 +984,7 @@ TEST_LIST = {{"test_map_correct", test_map_correct},
              {"test_mem_protect_remove_exec", test_mem_protect_remove_exec},
              {"test_mem_protect_mmio", test_mem_protect_mmio},
              {"test_snapshot", test_snapshot},
+             {"test_snapshot_page", test_snapshot_page},
              {"test_snapshot_with_vtlb", test_snapshot_with_vtlb},
              {"test_context_snapshot", test_context_snapshot},
              {"test_snapshot_unmap", test_snapshot_unmap},
@@ -608,4 +992,7 @@ TEST_LIST = {{"test_map_correct", test_map_correct},
               test_mem_read_and_write_large_memory_block},
              {"test_virtual_to_physical", test_virtual_to_physical},
              {"test_virtual_write", test_virtual_write},
+             {"test_mem_hook_page_bounded", test_mem_hook_page_bounded},
+             {"test_mem_read_write_blocks", test_mem_read_write_blocks},
+             {"test_mem_batch", test_mem_batch},
              {NULL, NULL}};
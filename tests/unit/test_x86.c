@@ -1111,6 +1111,469 @@ static void test_x86_nested_emu_stop(void)
     OK(uc_close(uc));
 }
 
+static void test_x86_timeout(void)
+{
+    uc_engine *uc;
+    // jmp $; inc ecx
+    char code[] = "\xeb\xfe\x41";
+    size_t timed_out = 1;
+    int r_ecx = 0;
+
+    uc_common_setup(&uc, UC_ARCH_X86, UC_MODE_32, code, sizeof(code) - 1);
+
+    // The infinite loop is stopped by the deadline.
+    OK(uc_emu_start(uc, code_start, code_start + 3, 10 * 1000, 0));
+    OK(uc_query(uc, UC_QUERY_TIMEOUT, &timed_out));
+    TEST_CHECK(timed_out == 1);
+
+    // A run which finishes in time doesn't report a timeout.
+    OK(uc_emu_start(uc, code_start + 2, code_start + 3, 10 * 1000 * 1000, 0));
+    OK(uc_query(uc, UC_QUERY_TIMEOUT, &timed_out));
+    OK(uc_reg_read(uc, UC_X86_REG_ECX, &r_ecx));
+    TEST_CHECK(timed_out == 0);
+    TEST_CHECK(r_ecx == 1);
+
+    OK(uc_close(uc));
+}
+
+static void test_x86_count_hook_block(uc_engine *uc, uint64_t address,
+                                      uint32_t size, void *user_data)
+{
+    (*(int *)user_data)++;
+}
+
+static void test_x86_count(void)
+{
+    uc_engine *uc;
+    // inc ecx; x 8; jmp $-8
+    char code[] = "\x41\x41\x41\x41\x41\x41\x41\x41\xeb\xf6";
+    int r_ecx = 0;
+    int blocks = 0;
+    uint32_t r_eip;
+    uc_hook h;
+
+    uc_common_setup(&uc, UC_ARCH_X86, UC_MODE_32, code, sizeof(code) - 1);
+    OK(uc_hook_add(uc, &h, UC_HOOK_BLOCK, test_x86_count_hook_block, &blocks,
+                   1, 0));
+
+    // The budget ends in the middle of the block.
+    OK(uc_emu_start(uc, code_start, code_start + sizeof(code) - 1, 0, 3));
+    OK(uc_reg_read(uc, UC_X86_REG_ECX, &r_ecx));
+    OK(uc_reg_read(uc, UC_X86_REG_EIP, &r_eip));
+    TEST_CHECK(r_ecx == 3);
+    TEST_CHECK(r_eip == code_start + 3);
+    TEST_CHECK(blocks == 1);
+
+    // The budget spans several iterations of the loop: 2 times 9
+    // instructions from the start of the block, then 4 more.
+    r_ecx = 0;
+    blocks = 0;
+    OK(uc_reg_write(uc, UC_X86_REG_ECX, &r_ecx));
+    OK(uc_emu_start(uc, code_start, code_start + sizeof(code) - 1, 0, 22));
+    OK(uc_reg_read(uc, UC_X86_REG_ECX, &r_ecx));
+    OK(uc_reg_read(uc, UC_X86_REG_EIP, &r_eip));
+    TEST_CHECK(r_ecx == 20);
+    TEST_CHECK(r_eip == code_start + 4);
+    TEST_CHECK(blocks == 3);
+
+    OK(uc_close(uc));
+}
+
+typedef struct {
+    int calls[16];
+    int order[16];
+    int norder;
+    uc_hook del;
+} HookIndexLog;
+
+static void test_x86_hook_index_code(uc_engine *uc, uint64_t address,
+                                     uint32_t size, void *user_data)
+{
+    HookIndexLog *log = user_data;
+    int i = (int)(address - code_start);
+
+    log->calls[i]++;
+    if (i == 4) {
+        // drops the hook of the instruction after next
+        OK(uc_hook_del(uc, log->del));
+    }
+}
+
+static void test_x86_hook_index_range(uc_engine *uc, uint64_t address,
+                                      uint32_t size, void *user_data)
+{
+    HookIndexLog *log = user_data;
+
+    log->order[log->norder++] = (int)(address - code_start);
+}
+
+static void test_x86_hook_index_write(uc_engine *uc, uc_mem_type type,
+                                      uint64_t address, int size,
+                                      int64_t value, void *user_data)
+{
+    (*(int *)user_data)++;
+}
+
+static void test_x86_hook_index(void)
+{
+    uc_engine *uc;
+    // inc ecx; x 8; mov [0x2000], ecx; mov [0x2100], ecx
+    char code[] = "\x41\x41\x41\x41\x41\x41\x41\x41"
+                  "\x89\x0d\x00\x20\x00\x00\x89\x0d\x00\x21\x00\x00";
+    HookIndexLog log = {0};
+    uc_hook h[8], hr1, hr2, hw;
+    int writes = 0;
+    int i;
+
+    uc_common_setup(&uc, UC_ARCH_X86, UC_MODE_32, code, sizeof(code) - 1);
+
+    // one hook per instruction, every dispatch must only see its own
+    for (i = 0; i < 8; i++) {
+        OK(uc_hook_add(uc, &h[i], UC_HOOK_CODE, test_x86_hook_index_code, &log,
+                       code_start + i, code_start + i));
+    }
+    log.del = h[6];
+
+    // overlapping ranges fire in the order they were added
+    OK(uc_hook_add(uc, &hr1, UC_HOOK_CODE, test_x86_hook_index_range, &log,
+                   code_start + 2, code_start + 3));
+    OK(uc_hook_add(uc, &hr2, UC_HOOK_CODE, test_x86_hook_index_range, &log,
+                   code_start + 3, code_start + 3));
+    OK(uc_hook_add(uc, &hw, UC_HOOK_MEM_WRITE, test_x86_hook_index_write,
+                   &writes, 0x2100, 0x2103));
+
+    OK(uc_emu_start(uc, code_start, code_start + sizeof(code) - 1, 0, 0));
+
+    for (i = 0; i < 8; i++) {
+        TEST_CHECK(log.calls[i] == (i == 6 ? 0 : 1));
+    }
+    TEST_CHECK(log.norder == 3);
+    TEST_CHECK(log.order[0] == 2);
+    TEST_CHECK(log.order[1] == 3);
+    TEST_CHECK(log.order[2] == 3);
+    TEST_CHECK(writes == 1);
+
+    OK(uc_close(uc));
+}
+
+static void test_x86_reset(void)
+{
+    uc_engine *uc;
+    uc_context *ctx;
+    // inc ecx; inc edx
+    char code[] = "\x41\x42";
+    int r_ecx = 5;
+    int blocks = 0;
+    uint8_t byte;
+    uc_hook h;
+
+    uc_common_setup(&uc, UC_ARCH_X86, UC_MODE_32, code, sizeof(code) - 1);
+    OK(uc_hook_add(uc, &h, UC_HOOK_BLOCK, test_x86_count_hook_block, &blocks,
+                   1, 0));
+    OK(uc_reg_write(uc, UC_X86_REG_ECX, &r_ecx));
+    OK(uc_emu_start(uc, code_start, code_start + sizeof(code) - 1, 0, 0));
+
+    // Registers go back to their initial value, the rest is kept.
+    OK(uc_reset(uc, 0));
+    OK(uc_reg_read(uc, UC_X86_REG_ECX, &r_ecx));
+    TEST_CHECK(r_ecx == 0);
+    OK(uc_emu_start(uc, code_start, code_start + sizeof(code) - 1, 0, 0));
+    OK(uc_reg_read(uc, UC_X86_REG_ECX, &r_ecx));
+    TEST_CHECK(r_ecx == 1);
+    TEST_CHECK(blocks == 2);
+
+    // Memory mapped or written under a snapshot is dropped as well.
+    OK(uc_ctl_context_mode(uc, UC_CTL_CONTEXT_MEMORY));
+    OK(uc_context_alloc(uc, &ctx));
+    OK(uc_context_save(uc, ctx));
+    OK(uc_mem_write(uc, code_start + 0x100, code, sizeof(code) - 1));
+    OK(uc_mem_map(uc, 0x10000, 0x1000, UC_PROT_ALL));
+
+    OK(uc_reset(uc, UC_RESET_ALL));
+    uc_assert_err(UC_ERR_READ_UNMAPPED,
+                  uc_mem_read(uc, code_start, &byte, sizeof(byte)));
+    uc_assert_err(UC_ERR_READ_UNMAPPED,
+                  uc_mem_read(uc, 0x10000, &byte, sizeof(byte)));
+
+    OK(uc_mem_map(uc, code_start, code_len, UC_PROT_ALL));
+    OK(uc_mem_write(uc, code_start, code, sizeof(code) - 1));
+    OK(uc_emu_start(uc, code_start, code_start + sizeof(code) - 1, 0, 0));
+    OK(uc_reg_read(uc, UC_X86_REG_ECX, &r_ecx));
+    TEST_CHECK(r_ecx == 1);
+    TEST_CHECK(blocks == 2);
+
+    OK(uc_context_free(ctx));
+    OK(uc_close(uc));
+}
+
+static bool test_x86_cross_page_chain_tlb(uc_engine *uc, uint64_t addr,
+                                          uc_mem_type type,
+                                          uc_tlb_entry *result,
+                                          void *user_data)
+{
+    // the second page of the code is backed by 0x2000 or 0x3000
+    result->paddr = addr;
+    if ((addr & ~0xfffULL) == 0x2000 && *(bool *)user_data) {
+        result->paddr += 0x1000;
+    }
+    result->perms = UC_PROT_ALL;
+    return true;
+}
+
+static void test_x86_cross_page_chain(void)
+{
+    uc_engine *uc;
+    uc_hook h;
+    bool remapped = false;
+    // dec edx; jz 0x1800; jmp 0x1ffe
+    char loop[] = "\x4a\x0f\x84\xf9\x07\x00\x00\xe9\xf2\x0f\x00\x00";
+    // nop; nop; then at 0x2000: inc ecx; jmp 0x1000
+    char tail[] = "\x90\x90";
+    char page_a[] = "\x41\xe9\xfa\xef\xff\xff";
+    // add ecx, 0x10; jmp 0x1000
+    char page_b[] = "\x83\xc1\x10\xe9\xf8\xef\xff\xff";
+    int r_ecx = 0;
+    int r_edx = 5;
+
+    OK(uc_open(UC_ARCH_X86, UC_MODE_32, &uc));
+    OK(uc_mem_map(uc, 0x1000, 0x3000, UC_PROT_ALL));
+    OK(uc_mem_write(uc, 0x1000, loop, sizeof(loop) - 1));
+    OK(uc_mem_write(uc, 0x1ffe, tail, sizeof(tail) - 1));
+    OK(uc_mem_write(uc, 0x2000, page_a, sizeof(page_a) - 1));
+    OK(uc_mem_write(uc, 0x3000, page_b, sizeof(page_b) - 1));
+    OK(uc_ctl_tlb_mode(uc, UC_TLB_VIRTUAL));
+    OK(uc_hook_add(uc, &h, UC_HOOK_TLB_FILL, test_x86_cross_page_chain_tlb,
+                   &remapped, 1, 0));
+
+    // The TB at 0x1ffe spans two pages, the loop jumps to it directly.
+    OK(uc_reg_write(uc, UC_X86_REG_EDX, &r_edx));
+    OK(uc_emu_start(uc, 0x1000, 0x1800, 0, 0));
+    OK(uc_reg_read(uc, UC_X86_REG_ECX, &r_ecx));
+    TEST_CHECK(r_ecx == 4);
+
+    // Moving its second page must not leave the jump to the old code.
+    remapped = true;
+    OK(uc_ctl_flush_tlb(uc));
+    r_edx = 5;
+    OK(uc_reg_write(uc, UC_X86_REG_EDX, &r_edx));
+    OK(uc_emu_start(uc, 0x1000, 0x1800, 0, 0));
+    OK(uc_reg_read(uc, UC_X86_REG_ECX, &r_ecx));
+    TEST_CHECK(r_ecx == 4 + 4 * 0x10);
+
+    OK(uc_close(uc));
+}
+
+static void test_x86_inline_cache(void)
+{
+    uc_engine *uc;
+    // mov ecx, 100
+    // loop: mov eax, 0x1100; test ecx, 1; jz skip; mov eax, 0x1200
+    // skip: call eax; dec ecx; jnz loop
+    char code[] = "\xb9\x64\x00\x00\x00\xb8\x00\x11\x00\x00\xf7\xc1\x01\x00"
+                  "\x00\x00\x74\x05\xb8\x00\x12\x00\x00\xff\xd0\x49\x75\xe9";
+    // inc ebx; ret
+    char f1[] = "\x43\xc3";
+    // add edx, 2; ret
+    char f2[] = "\x83\xc2\x02\xc3";
+    // add ebx, 3; ret
+    char f1_new[] = "\x83\xc3\x03\xc3";
+    int modes[] = {UC_TB_IC_NONE, UC_TB_IC_INDIRECT, UC_TB_IC_RETURN,
+                   UC_TB_IC_INDIRECT | UC_TB_IC_RETURN};
+    int mode;
+    int r_esp, r_ebx, r_edx;
+    int i;
+
+    OK(uc_open(UC_ARCH_X86, UC_MODE_32, &uc));
+    OK(uc_mem_map(uc, 0x1000, 0x8000, UC_PROT_ALL));
+    OK(uc_ctl_get_tb_inline_cache(uc, &mode));
+    TEST_CHECK(mode == UC_TB_IC_NONE);
+    uc_assert_err(UC_ERR_ARG, uc_ctl_tb_inline_cache(uc, 4));
+
+    for (i = 0; i < sizeof(modes) / sizeof(modes[0]); i++) {
+        OK(uc_ctl_tb_inline_cache(uc, modes[i]));
+        OK(uc_ctl_get_tb_inline_cache(uc, &mode));
+        TEST_CHECK(mode == modes[i]);
+
+        OK(uc_mem_write(uc, 0x1000, code, sizeof(code) - 1));
+        OK(uc_mem_write(uc, 0x1100, f1, sizeof(f1) - 1));
+        OK(uc_mem_write(uc, 0x1200, f2, sizeof(f2) - 1));
+        r_esp = 0x8000;
+        r_ebx = r_edx = 0;
+        OK(uc_reg_write(uc, UC_X86_REG_ESP, &r_esp));
+        OK(uc_reg_write(uc, UC_X86_REG_EBX, &r_ebx));
+        OK(uc_reg_write(uc, UC_X86_REG_EDX, &r_edx));
+        OK(uc_emu_start(uc, 0x1000, 0x1000 + sizeof(code) - 1, 0, 0));
+        OK(uc_reg_read(uc, UC_X86_REG_EBX, &r_ebx));
+        OK(uc_reg_read(uc, UC_X86_REG_EDX, &r_edx));
+        TEST_CHECK(r_ebx == 50);
+        TEST_CHECK(r_edx == 100);
+
+        // The cached calls and returns must not reach the old code.
+        OK(uc_mem_write(uc, 0x1100, f1_new, sizeof(f1_new) - 1));
+        OK(uc_ctl_remove_cache(uc, 0x1100, 0x1100 + sizeof(f1_new) - 1));
+        OK(uc_emu_start(uc, 0x1000, 0x1000 + sizeof(code) - 1, 0, 0));
+        OK(uc_reg_read(uc, UC_X86_REG_EBX, &r_ebx));
+        OK(uc_reg_read(uc, UC_X86_REG_EDX, &r_edx));
+        OK(uc_reg_read(uc, UC_X86_REG_ESP, &r_esp));
+        TEST_CHECK(r_ebx == 50 + 150);
+        TEST_CHECK(r_edx == 200);
+        TEST_CHECK(r_esp == 0x8000);
+    }
+
+    OK(uc_close(uc));
+}
+
+static void test_x86_superblock(void)
+{
+    uc_engine *uc;
+    // mov ecx, 1000; xor eax, eax; xor ebx, ebx
+    // loop: inc eax; test cl, 7; jnz skip; add ebx, 1
+    // skip: jmp next; int3
+    // next: dec ecx; jnz loop
+    char code[] = "\xb9\xe8\x03\x00\x00\x31\xc0\x31\xdb\x40\xf6\xc1\x07\x75\x03"
+                  "\x83\xc3\x01\xeb\x01\xcc\x49\x75\xf1";
+    uint32_t threshold;
+    int r_eax, r_ebx, r_ecx, r_eip;
+    int i;
+
+    uc_common_setup(&uc, UC_ARCH_X86, UC_MODE_32, code, sizeof(code) - 1);
+    OK(uc_ctl_get_tb_superblock(uc, &threshold));
+    TEST_CHECK(threshold == 0);
+    OK(uc_ctl_tb_superblock(uc, 10));
+    OK(uc_ctl_get_tb_superblock(uc, &threshold));
+    TEST_CHECK(threshold == 10);
+
+    // The second run starts with the superblocks built by the first one.
+    for (i = 0; i < 2; i++) {
+        OK(uc_emu_start(uc, code_start, code_start + sizeof(code) - 1, 0, 0));
+        OK(uc_reg_read(uc, UC_X86_REG_EAX, &r_eax));
+        OK(uc_reg_read(uc, UC_X86_REG_EBX, &r_ebx));
+        OK(uc_reg_read(uc, UC_X86_REG_ECX, &r_ecx));
+        TEST_CHECK(r_eax == 1000);
+        TEST_CHECK(r_ebx == 125);
+        TEST_CHECK(r_ecx == 0);
+    }
+
+    // The instruction budget is exact: 3 + 7 for the first iteration, then
+    // inc and test of the second.
+    OK(uc_emu_start(uc, code_start, code_start + sizeof(code) - 1, 0, 12));
+    OK(uc_reg_read(uc, UC_X86_REG_EAX, &r_eax));
+    OK(uc_reg_read(uc, UC_X86_REG_EBX, &r_ebx));
+    OK(uc_reg_read(uc, UC_X86_REG_ECX, &r_ecx));
+    OK(uc_reg_read(uc, UC_X86_REG_EIP, &r_eip));
+    TEST_CHECK(r_eax == 2);
+    TEST_CHECK(r_ebx == 1);
+    TEST_CHECK(r_ecx == 999);
+    TEST_CHECK(r_eip == code_start + 0xd);
+
+    // Patching the cold side of a superblock takes effect.
+    OK(uc_emu_start(uc, code_start, code_start + sizeof(code) - 1, 0, 0));
+    OK(uc_mem_write(uc, code_start + 0x11, "\x02", 1));
+    OK(uc_ctl_remove_cache(uc, code_start + 0x11, code_start + 0x12));
+    OK(uc_emu_start(uc, code_start, code_start + sizeof(code) - 1, 0, 0));
+    OK(uc_reg_read(uc, UC_X86_REG_EAX, &r_eax));
+    OK(uc_reg_read(uc, UC_X86_REG_EBX, &r_ebx));
+    TEST_CHECK(r_eax == 1000);
+    TEST_CHECK(r_ebx == 250);
+
+    OK(uc_close(uc));
+}
+
+typedef struct {
+    int code[3][4];
+    int blocks[2];
+    int stop_at;
+    bool add;
+    uc_hook added;
+    void *added_arg;
+} InlineHooksLog;
+
+typedef struct {
+    InlineHooksLog *log;
+    int id;
+} InlineHooksArg;
+
+static void test_x86_inline_hooks_code(uc_engine *uc, uint64_t address,
+                                       uint32_t size, void *user_data)
+{
+    InlineHooksArg *arg = user_data;
+    InlineHooksLog *log = arg->log;
+    int i = (int)(address - code_start);
+
+    log->code[arg->id][i]++;
+    if (arg->id == 0 && i == log->stop_at) {
+        OK(uc_emu_stop(uc));
+    }
+    if (arg->id == 0 && i == 1 && log->add) {
+        log->add = false;
+        OK(uc_hook_add(uc, &log->added, UC_HOOK_CODE,
+                       test_x86_inline_hooks_code, log->added_arg,
+                       code_start + 1, code_start + 1));
+    }
+}
+
+static void test_x86_inline_hooks_block(uc_engine *uc, uint64_t address,
+                                        uint32_t size, void *user_data)
+{
+    InlineHooksArg *arg = user_data;
+
+    TEST_CHECK(size == 5);
+    arg->log->blocks[arg->id]++;
+}
+
+static void test_x86_inline_hooks(void)
+{
+    uc_engine *uc;
+    // loop: inc ecx; inc edx; dec eax; jnz loop
+    char code[] = "\x41\x42\x48\x75\xfb";
+    InlineHooksLog log = {{{0}}, {0}, -1};
+    InlineHooksArg args[3] = {{&log, 0}, {&log, 1}, {&log, 2}};
+    uc_hook h;
+    int r_eax = 3, r_ecx = 0;
+    int i;
+
+    uc_common_setup(&uc, UC_ARCH_X86, UC_MODE_32, code, sizeof(code) - 1);
+    OK(uc_hook_add(uc, &h, UC_HOOK_CODE, test_x86_inline_hooks_code, &args[0],
+                   1, 0));
+    OK(uc_hook_add(uc, &h, UC_HOOK_CODE, test_x86_inline_hooks_code, &args[1],
+                   1, 0));
+    OK(uc_hook_add(uc, &h, UC_HOOK_BLOCK, test_x86_inline_hooks_block,
+                   &args[0], 1, 0));
+    OK(uc_hook_add(uc, &h, UC_HOOK_BLOCK, test_x86_inline_hooks_block,
+                   &args[1], 1, 0));
+
+    OK(uc_reg_write(uc, UC_X86_REG_EAX, &r_eax));
+    OK(uc_emu_start(uc, code_start, code_start + sizeof(code) - 1, 0, 0));
+    for (i = 0; i < 4; i++) {
+        TEST_CHECK(log.code[0][i] == 3);
+        TEST_CHECK(log.code[1][i] == 3);
+    }
+    TEST_CHECK(log.blocks[0] == 3);
+    TEST_CHECK(log.blocks[1] == 3);
+
+    // A hook added in the first iteration retranslates the hooked loop.
+    log.add = true;
+    log.added_arg = &args[2];
+    OK(uc_reg_write(uc, UC_X86_REG_EAX, &r_eax));
+    OK(uc_emu_start(uc, code_start, code_start + sizeof(code) - 1, 0, 0));
+    TEST_CHECK(log.code[0][1] == 6);
+    TEST_CHECK(log.code[2][0] == 0);
+    TEST_CHECK(log.code[2][1] == 2);
+
+    // Stopping in the first hook skips the others of the instruction.
+    log.stop_at = 1;
+    OK(uc_reg_write(uc, UC_X86_REG_EAX, &r_eax));
+    OK(uc_reg_write(uc, UC_X86_REG_ECX, &r_ecx));
+    OK(uc_emu_start(uc, code_start, code_start + sizeof(code) - 1, 0, 0));
+    OK(uc_reg_read(uc, UC_X86_REG_ECX, &r_ecx));
+    TEST_CHECK(r_ecx == 1);
+    TEST_CHECK(log.code[0][1] == 7);
+    TEST_CHECK(log.code[1][1] == 6);
+    TEST_CHECK(log.code[2][1] == 2);
+
+    OK(uc_close(uc));
+}
+
 static void test_x86_nested_emu_start_error_cb(uc_engine *uc, uint64_t addr,
                                                size_t size, void *data)
 {
@@ -2265,4 +2728,12 @@ TEST_LIST = {
     {"test_x86_dr7", test_x86_dr7},
     {"test_x86_hook_block", test_x86_hook_block},
     {"test_x86_mem_hooks_pc_guarantee", test_x86_mem_hooks_pc_guarantee},
+    {"test_x86_timeout", test_x86_timeout},
+    {"test_x86_count", test_x86_count},
+    {"test_x86_hook_index", test_x86_hook_index},
+    {"test_x86_reset", test_x86_reset},
+    {"test_x86_cross_page_chain", test_x86_cross_page_chain},
+    {"test_x86_inline_cache", test_x86_inline_cache},
+    {"test_x86_superblock", test_x86_superblock},
+    {"test_x86_inline_hooks", test_x86_inline_hooks},
     {NULL, NULL}};
@@ -34,6 +34,7 @@
 static void clear_deleted_hooks(uc_engine *uc);
 static uc_err uc_snapshot(uc_engine *uc);
 static uc_err uc_restore_latest_snapshot(uc_engine *uc);
+static int bsearch_mapped_blocks(const uc_engine *uc, uint64_t address);
 
 #if defined(__APPLE__) && defined(HAVE_PTHREAD_JIT_PROTECT) &&                 \
     (defined(__arm__) || defined(__aarch64__))
@@ -99,6 +100,39 @@ static void hook_invalidate_region(void *key, void *data, void *opaq)
     uc->uc_invalidate_tb(uc, region->start, region->length);
 }
 
+struct hook_invalidate_ctx {
+    uc_engine *uc;
+    struct hook *hook;
+};
+
+// The code and block hooks covering an address are called directly from the
+// translated code, so a new hook must retranslate the blocks already hooked
+// there. Blocks without any hook are still left alone.
+static void hook_invalidate_overlap(void *key, void *data, void *opaq)
+{
+    struct hook_invalidate_ctx *ctx = (struct hook_invalidate_ctx *)opaq;
+    HookedRegion *region = (HookedRegion *)key;
+
+    if (hooked_regions_overlap(ctx->hook, region->start, region->length)) {
+        ctx->uc->uc_invalidate_tb(ctx->uc, region->start, region->length);
+    }
+}
+
+static void hook_invalidate_added(uc_engine *uc, int idx, struct hook *hook)
+{
+    struct hook_invalidate_ctx ctx = {uc, hook};
+    struct list_item *cur;
+    struct hook *other;
+
+    for (cur = uc->hook[idx].head; cur != NULL; cur = cur->next) {
+        other = (struct hook *)cur->data;
+        if (other != hook && !other->to_delete) {
+            g_hash_table_foreach(other->hooked_regions,
+                                 hook_invalidate_overlap, &ctx);
+        }
+    }
+}
+
 static void hook_delete(void *data)
 {
     struct hook *h = (struct hook *)data;
@@ -279,6 +313,10 @@ static uc_err uc_init_engine(uc_engine *uc)
         uc->hook[i].delete_fn = hook_delete;
     }
 
+    // hook_index starts out stale and is built on first use
+    uc->hooks_gen = 1;
+    uc->hook_index_retired.delete_fn = g_free;
+
     uc->ctl_exits = g_tree_new_full(uc_exits_cmp, NULL, g_free, NULL);
 
     if (machine_initialize(uc)) {
@@ -300,6 +338,8 @@ static uc_err uc_init_engine(uc_engine *uc)
     uc->context_content = UC_CTL_CONTEXT_CPU;
 
     uc->unmapped_regions = g_array_new(false, false, sizeof(MemoryRegion *));
+    uc->snapshot_pages =
+        g_array_new(false, false, sizeof(struct uc_snapshot_page));
 
     uc->init_done = true;
 
@@ -540,6 +580,8 @@ uc_err uc_close(uc_engine *uc)
         g_free(mr);
     }
     g_array_free(uc->unmapped_regions, true);
+    g_array_free(uc->snapshot_pages, true);
+    g_free(uc->snapshot_pool);
 
     // Thread relateds.
     if (uc->qemu_thread_data) {
@@ -561,7 +603,9 @@ uc_err uc_close(uc_engine *uc)
 
     for (i = 0; i < UC_HOOK_MAX; i++) {
         list_clear(&uc->hook[i]);
+        g_free(uc->hook_index[i].mem);
     }
+    list_clear(&uc->hook_index_retired);
 
     free(uc->mapped_blocks);
 
@@ -574,6 +618,71 @@ uc_err uc_close(uc_engine *uc)
     return UC_ERR_OK;
 }
 
+static void reset_hooks(uc_engine *uc)
+{
+    struct list_item *cur;
+    struct hook *hook;
+    int i;
+
+    for (i = 0; i < UC_HOOK_MAX; i++) {
+        for (cur = uc->hook[i].head;
+             cur != NULL && (hook = (struct hook *)cur->data);
+             cur = cur->next) {
+            if (!hook->to_delete) {
+                uc_hook_del(uc, (uc_hook)hook);
+            }
+        }
+    }
+
+    clear_deleted_hooks(uc);
+}
+
+UNICORN_EXPORT
+uc_err uc_reset(uc_engine *uc, int flags)
+{
+    UC_INIT(uc);
+
+    if (uc->nested_level > 0 || (flags & ~UC_RESET_ALL)) {
+        restore_jit_state(uc);
+        return UC_ERR_ARG;
+    }
+
+    if (flags & UC_RESET_HOOKS) {
+        reset_hooks(uc);
+    }
+
+    if (flags & UC_RESET_MEMORY) {
+        // snapshots go away with the regions they were taken of
+        uc->memory_reset(uc);
+    }
+
+    // TBs translated from memory that is no longer mapped must not survive
+    if (flags & (UC_RESET_MEMORY | UC_RESET_TB_CACHE)) {
+        uc->tb_flush(uc);
+    }
+
+    // Same sequence as uc_init_engine(), the TB hash table is left alone.
+    if (uc->cpu->cc->reset) {
+        uc->cpu->cc->reset(uc->cpu);
+    }
+    if (uc->reg_reset) {
+        uc->reg_reset(uc);
+    }
+
+    g_tree_remove_all(uc->ctl_exits);
+    uc->use_exits = false;
+    uc->timeout = 0;
+    uc->timed_out = false;
+    uc->stop_request = false;
+    uc->quit_request = false;
+    uc->invalid_error = UC_ERR_OK;
+    uc->invalid_addr = 0;
+    uc->last_tb = NULL;
+
+    restore_jit_state(uc);
+    return UC_ERR_OK;
+}
+
 UNICORN_EXPORT
 uc_err uc_reg_read_batch(uc_engine *uc, int const *regs, void **vals, int count)
 {
@@ -746,6 +855,18 @@ uc_err uc_reg_write2(uc_engine *uc, int regid, const void *value, size_t *size)
     return UC_ERR_OK;
 }
 
+// where mr starts in the address space, contained blocks have an address
+// relative to their container
+static uint64_t memory_region_start(uc_engine *uc, MemoryRegion *mr)
+{
+    hwaddr start = mr->addr;
+    while (mr->container != uc->system_memory) {
+        mr = mr->container;
+        start += mr->addr;
+    }
+    return start;
+}
+
 static uint64_t memory_region_len(uc_engine *uc, MemoryRegion *mr,
                                   uint64_t address, uint64_t count)
 {
@@ -777,25 +898,52 @@ static bool check_mem_area(uc_engine *uc, uint64_t address, size_t size)
     return (count == size);
 }
 
-uc_err uc_vmem_translate(uc_engine *uc, uint64_t address, uc_prot prot,
-                              uint64_t *paddress)
+// find the mapped block holding [address, address + size) if it is plain RAM
+// mapped straight into the system memory, so that it can be accessed through
+// its host pointer. MMIO and blocks split up by snapshots return NULL.
+static MemoryRegion *find_ram_block(uc_engine *uc, uint64_t address,
+                                    uint64_t size)
 {
-    UC_INIT(uc);
+    MemoryRegion *mr;
+    uint32_t i = uc->mapped_block_cache_index;
+
+    if (i >= uc->mapped_block_count ||
+        address - uc->mapped_blocks[i]->addr >=
+            uc->mapped_blocks[i]->end - uc->mapped_blocks[i]->addr) {
+        i = bsearch_mapped_blocks(uc, address);
+        if (i >= uc->mapped_block_count) {
+            return NULL;
+        }
+        uc->mapped_block_cache_index = i;
+    }
+
+    mr = uc->mapped_blocks[i];
+    // contained blocks have an address relative to their container
+    if (mr->container != uc->system_memory || !mr->ram || !mr->ram_block) {
+        return NULL;
+    }
+    if (address - mr->addr >= mr->end - mr->addr ||
+        size > mr->end - address) {
+        return NULL;
+    }
+
+    return mr;
+}
 
+static uc_err vmem_translate(uc_engine *uc, uint64_t address, uc_prot prot,
+                             uint64_t *paddress)
+{
     if (!(UC_PROT_READ == prot || UC_PROT_WRITE == prot ||
           UC_PROT_EXEC == prot)) {
-        restore_jit_state(uc);
         return UC_ERR_ARG;
     }
 
     // The sparc mmu doesn't support probe mode
     if (uc->arch == UC_ARCH_SPARC && uc->cpu->cc->tlb_fill == uc->cpu->cc->tlb_fill_cpu) {
-        restore_jit_state(uc);
         return UC_ERR_ARG;
     }
 
     if (!uc->virtual_to_physical(uc, address, prot, paddress)) {
-        restore_jit_state(uc);
         switch (prot) {
         case UC_PROT_READ:
             return UC_ERR_READ_PROT;
@@ -808,36 +956,42 @@ uc_err uc_vmem_translate(uc_engine *uc, uint64_t address, uc_prot prot,
         }
     }
 
-    restore_jit_state(uc);
     return UC_ERR_OK;
 }
 
-UNICORN_EXPORT
-uc_err uc_vmem_read(uc_engine *uc, uint64_t address, uc_prot prot,
-                           void *_bytes, size_t size)
+uc_err uc_vmem_translate(uc_engine *uc, uint64_t address, uc_prot prot,
+                              uint64_t *paddress)
+{
+    uc_err err;
+
+    UC_INIT(uc);
+
+    err = vmem_translate(uc, address, prot, paddress);
+
+    restore_jit_state(uc);
+    return err;
+}
+
+static uc_err vmem_read(uc_engine *uc, uint64_t address, uc_prot prot,
+                        void *_bytes, size_t size)
 {
     size_t count = 0, len;
     uint8_t *bytes = _bytes;
     uint64_t align;
     uint64_t pagesize;
 
-    UC_INIT(uc);
-
     // qemu cpu_physical_memory_rw() size is an int
     if (size > INT_MAX) {
-        restore_jit_state(uc);
         return UC_ERR_ARG;
     }
 
     // The sparc mmu doesn't support probe mode
     if (uc->arch == UC_ARCH_SPARC && uc->cpu->cc->tlb_fill == uc->cpu->cc->tlb_fill_cpu) {
-        restore_jit_state(uc);
         return UC_ERR_ARG;
     }
 
     if (!(UC_PROT_READ == prot || UC_PROT_WRITE == prot ||
           UC_PROT_EXEC == prot)) {
-        restore_jit_state(uc);
         return UC_ERR_ARG;
     }
 
@@ -846,7 +1000,6 @@ uc_err uc_vmem_read(uc_engine *uc, uint64_t address, uc_prot prot,
         pagesize = uc->target_page_size;
         len = MIN(size - count, (address & ~align) + pagesize - address);
         if (!uc->read_mem_virtual(uc, address, prot, bytes, len)) {
-            restore_jit_state(uc);
             return UC_ERR_READ_PROT;
         }
         bytes += len;
@@ -854,37 +1007,47 @@ uc_err uc_vmem_read(uc_engine *uc, uint64_t address, uc_prot prot,
         count += len;
     }
     assert(count == size);
-    restore_jit_state(uc);
     return UC_ERR_OK;
 }
 
 UNICORN_EXPORT
-uc_err uc_vmem_write(uc_engine *uc, uint64_t address, uc_prot prot,
+uc_err uc_vmem_read(uc_engine *uc, uint64_t address, uc_prot prot,
                            void *_bytes, size_t size)
+{
+    uc_err err;
+
+    UC_INIT(uc);
+
+    err = vmem_read(uc, address, prot, _bytes, size);
+
+    restore_jit_state(uc);
+    return err;
+}
+
+static uc_err mem_write(uc_engine *uc, uint64_t address, const void *_bytes,
+                        uint64_t size);
+
+static uc_err vmem_write(uc_engine *uc, uint64_t address, uc_prot prot,
+                         const void *_bytes, size_t size)
 {
     size_t count = 0, len;
-    uint8_t *bytes = _bytes;
+    const uint8_t *bytes = _bytes;
     uint64_t align;
     uint64_t pagesize;
     uint64_t paddr = 0;
 
-    UC_INIT(uc);
-
     // qemu cpu_physical_memory_rw() size is an int
     if (size > INT_MAX) {
-        restore_jit_state(uc);
         return UC_ERR_ARG;
     }
 
     // The sparc mmu doesn't support probe mode
     if (uc->arch == UC_ARCH_SPARC && uc->cpu->cc->tlb_fill == uc->cpu->cc->tlb_fill_cpu) {
-        restore_jit_state(uc);
         return UC_ERR_ARG;
     }
 
     if (!(UC_PROT_READ == prot || UC_PROT_WRITE == prot ||
           UC_PROT_EXEC == prot)) {
-        restore_jit_state(uc);
         return UC_ERR_ARG;
     }
 
@@ -892,12 +1055,10 @@ uc_err uc_vmem_write(uc_engine *uc, uint64_t address, uc_prot prot,
         align = uc->target_page_align;
         pagesize = uc->target_page_size;
         len = MIN(size - count, (address & ~align) + pagesize - address);
-	if (uc_vmem_translate(uc, address, prot, &paddr) != UC_ERR_OK) {
-            restore_jit_state(uc);
+        if (vmem_translate(uc, address, prot, &paddr) != UC_ERR_OK) {
             return UC_ERR_WRITE_PROT;
-	}
-        if (uc_mem_write(uc, paddr, bytes, len) != UC_ERR_OK) {
-            restore_jit_state(uc);
+        }
+        if (mem_write(uc, paddr, bytes, len) != UC_ERR_OK) {
             return UC_ERR_WRITE_PROT;
         }
         bytes += len;
@@ -905,26 +1066,44 @@ uc_err uc_vmem_write(uc_engine *uc, uint64_t address, uc_prot prot,
         count += len;
     }
     assert(count == size);
-    restore_jit_state(uc);
     return UC_ERR_OK;
 }
 
 UNICORN_EXPORT
-uc_err uc_mem_read(uc_engine *uc, uint64_t address, void *_bytes, uint64_t size)
+uc_err uc_vmem_write(uc_engine *uc, uint64_t address, uc_prot prot,
+                           void *_bytes, size_t size)
+{
+    uc_err err;
+
+    UC_INIT(uc);
+
+    err = vmem_write(uc, address, prot, _bytes, size);
+
+    restore_jit_state(uc);
+    return err;
+}
+
+static uc_err mem_read(uc_engine *uc, uint64_t address, void *_bytes,
+                       uint64_t size)
 {
     uint64_t count = 0, len;
     uint8_t *bytes = _bytes;
+    MemoryRegion *mr;
 
-    UC_INIT(uc);
+    // fast path: the whole area is in a single RAM block
+    mr = find_ram_block(uc, address, size);
+    if (mr) {
+        memcpy(bytes, mr->ram_block->host + (address - mr->addr), size);
+        return UC_ERR_OK;
+    }
 
     if (!check_mem_area(uc, address, size)) {
-        restore_jit_state(uc);
         return UC_ERR_READ_UNMAPPED;
     }
 
     // memory area can overlap adjacent memory blocks
     while (count < size) {
-        MemoryRegion *mr = uc->memory_mapping(uc, address);
+        mr = uc->memory_mapping(uc, address);
         if (mr) {
             len = memory_region_len(uc, mr, address, size - count);
             if (uc->read_mem(&uc->address_space_memory, address, bytes, len) ==
@@ -940,31 +1119,56 @@ uc_err uc_mem_read(uc_engine *uc, uint64_t address, void *_bytes, uint64_t size)
     }
 
     if (count == size) {
-        restore_jit_state(uc);
         return UC_ERR_OK;
     } else {
-        restore_jit_state(uc);
         return UC_ERR_READ_UNMAPPED;
     }
 }
 
 UNICORN_EXPORT
-uc_err uc_mem_write(uc_engine *uc, uint64_t address, const void *_bytes,
-                    uint64_t size)
+uc_err uc_mem_read(uc_engine *uc, uint64_t address, void *_bytes, uint64_t size)
+{
+    uc_err err;
+
+    UC_INIT(uc);
+
+    err = mem_read(uc, address, _bytes, size);
+
+    restore_jit_state(uc);
+    return err;
+}
+
+static uc_err mem_write(uc_engine *uc, uint64_t address, const void *_bytes,
+                        uint64_t size)
 {
     uint64_t count = 0, len;
     const uint8_t *bytes = _bytes;
+    MemoryRegion *mr;
 
-    UC_INIT(uc);
+    // fast path: the whole area is in a single RAM block, which isn't
+    // subject to a region snapshot. Write protection doesn't apply to us.
+    mr = find_ram_block(uc, address, size);
+    if (mr && (!uc->snapshot_level || uc->snapshot_level <= mr->priority ||
+               uc->snapshot_type == UC_SNAPSHOT_PAGE)) {
+        if (uc->snapshot_level && uc->snapshot_level > mr->priority) {
+            uint64_t align = uc->target_page_align;
+            // page snapshots save the pages aside and keep the block
+            if (!uc->memory_cow(uc, mr, address & ~align,
+                                (size + (address & align) + align) & ~align)) {
+                return UC_ERR_NOMEM;
+            }
+        }
+        memcpy(mr->ram_block->host + (address - mr->addr), bytes, size);
+        return UC_ERR_OK;
+    }
 
     if (!check_mem_area(uc, address, size)) {
-        restore_jit_state(uc);
         return UC_ERR_WRITE_UNMAPPED;
     }
 
     // memory area can overlap adjacent memory blocks
     while (count < size) {
-        MemoryRegion *mr = uc->memory_mapping(uc, address);
+        mr = uc->memory_mapping(uc, address);
         if (mr) {
             uint32_t operms = mr->perms;
             uint64_t align = uc->target_page_align;
@@ -1001,56 +1205,120 @@ uc_err uc_mem_write(uc_engine *uc, uint64_t address, const void *_bytes,
     }
 
     if (count == size) {
-        restore_jit_state(uc);
         return UC_ERR_OK;
     } else {
-        restore_jit_state(uc);
         return UC_ERR_WRITE_UNMAPPED;
     }
 }
 
-#define TIMEOUT_STEP 2 // microseconds
-static void *_timeout_fn(void *arg)
+UNICORN_EXPORT
+uc_err uc_mem_write(uc_engine *uc, uint64_t address, const void *_bytes,
+                    uint64_t size)
 {
-    struct uc_struct *uc = arg;
-    int64_t current_time = get_clock();
+    uc_err err;
 
-    do {
-        usleep(TIMEOUT_STEP);
-        // perhaps emulation is even done before timeout?
-        if (uc->emulation_done) {
-            break;
+    UC_INIT(uc);
+
+    err = mem_write(uc, address, _bytes, size);
+
+    restore_jit_state(uc);
+    return err;
+}
+
+UNICORN_EXPORT
+uc_err uc_mem_read_batch(uc_engine *uc, const uint64_t *addrs,
+                         void *const *bufs, const size_t *sizes, uc_err *errs,
+                         int count)
+{
+    uc_err err = UC_ERR_OK;
+    int i;
+
+    UC_INIT(uc);
+
+    for (i = 0; i < count; i++) {
+        uc_err ret = mem_read(uc, addrs[i], bufs[i], sizes[i]);
+        if (errs) {
+            errs[i] = ret;
+        }
+        if (ret != UC_ERR_OK && err == UC_ERR_OK) {
+            err = ret;
         }
-    } while ((uint64_t)(get_clock() - current_time) < uc->timeout);
+    }
 
-    // timeout before emulation is done?
-    if (!uc->emulation_done) {
-        uc->timed_out = true;
-        // force emulation to stop
-        uc_emu_stop(uc);
+    restore_jit_state(uc);
+    return err;
+}
+
+UNICORN_EXPORT
+uc_err uc_mem_write_batch(uc_engine *uc, const uint64_t *addrs,
+                          const void *const *bufs, const size_t *sizes,
+                          uc_err *errs, int count)
+{
+    uc_err err = UC_ERR_OK;
+    int i;
+
+    UC_INIT(uc);
+
+    for (i = 0; i < count; i++) {
+        uc_err ret = mem_write(uc, addrs[i], bufs[i], sizes[i]);
+        if (errs) {
+            errs[i] = ret;
+        }
+        if (ret != UC_ERR_OK && err == UC_ERR_OK) {
+            err = ret;
+        }
     }
 
-    return NULL;
+    restore_jit_state(uc);
+    return err;
 }
 
-static void enable_emu_timer(uc_engine *uc, uint64_t timeout)
+UNICORN_EXPORT
+uc_err uc_vmem_read_batch(uc_engine *uc, const uint64_t *addrs, uc_prot prot,
+                          void *const *bufs, const size_t *sizes, uc_err *errs,
+                          int count)
 {
-    uc->timeout = timeout;
-    qemu_thread_create(uc, &uc->timer, "timeout", _timeout_fn, uc,
-                       QEMU_THREAD_JOINABLE);
+    uc_err err = UC_ERR_OK;
+    int i;
+
+    UC_INIT(uc);
+
+    for (i = 0; i < count; i++) {
+        uc_err ret = vmem_read(uc, addrs[i], prot, bufs[i], sizes[i]);
+        if (errs) {
+            errs[i] = ret;
+        }
+        if (ret != UC_ERR_OK && err == UC_ERR_OK) {
+            err = ret;
+        }
+    }
+
+    restore_jit_state(uc);
+    return err;
 }
 
-static void hook_count_cb(struct uc_struct *uc, uint64_t address, uint32_t size,
-                          void *user_data)
+UNICORN_EXPORT
+uc_err uc_vmem_write_batch(uc_engine *uc, const uint64_t *addrs, uc_prot prot,
+                           const void *const *bufs, const size_t *sizes,
+                           uc_err *errs, int count)
 {
-    // count this instruction. ah ah ah.
-    uc->emu_counter++;
-    // printf(":: emu counter = %u, at %lx\n", uc->emu_counter, address);
+    uc_err err = UC_ERR_OK;
+    int i;
+
+    UC_INIT(uc);
 
-    if (uc->emu_counter > uc->emu_count) {
-        // printf(":: emu counter = %u, stop emulation\n", uc->emu_counter);
-        uc_emu_stop(uc);
+    for (i = 0; i < count; i++) {
+        uc_err ret = vmem_write(uc, addrs[i], prot, bufs[i], sizes[i]);
+        if (errs) {
+            errs[i] = ret;
+        }
+        if (ret != UC_ERR_OK && err == UC_ERR_OK) {
+            err = ret;
+        }
     }
+
+    restore_jit_state(uc);
+    return err;
 }
 
 static void clear_deleted_hooks(uc_engine *uc)
@@ -1070,6 +1338,10 @@ static void clear_deleted_hooks(uc_engine *uc)
     }
 
     list_clear(&uc->hooks_to_del);
+    uc->hooks_gen++;
+
+    // no dispatch is running any more, drop the indexes it might have used
+    list_clear(&uc->hook_index_retired);
 }
 
 UNICORN_EXPORT
@@ -1077,9 +1349,9 @@ uc_err uc_emu_start(uc_engine *uc, uint64_t begin, uint64_t until,
                     uint64_t timeout, size_t count)
 {
     uc_err err;
+    int64_t deadline, prev_deadline;
+    size_t prev_count, prev_counter;
 
-    // reset the counter
-    uc->emu_counter = 0;
     uc->invalid_error = UC_ERR_OK;
     uc->emulation_done = false;
     uc->size_recur_mem = 0;
@@ -1189,44 +1461,50 @@ uc_err uc_emu_start(uc_engine *uc, uint64_t begin, uint64_t until,
     uc->skip_sync_pc_on_exit = false;
     uc->stop_request = false;
 
-    uc->emu_count = count;
-    // remove count hook if counting isn't necessary
-    if (count <= 0 && uc->count_hook != 0) {
-        uc_hook_del(uc, uc->count_hook);
-        uc->count_hook = 0;
-
-        // In this case, we have to drop all translated blocks.
-        uc->tb_flush(uc);
-    }
-    // set up count hook to count instructions.
-    if (count > 0 && uc->count_hook == 0) {
-        uc_err err;
-        // callback to count instructions must be run before everything else,
-        // so instead of appending, we must insert the hook at the begin
-        // of the hook list
-        uc->hook_insert = 1;
-        err = uc_hook_add(uc, &uc->count_hook, UC_HOOK_CODE, hook_count_cb,
-                          NULL, 1, 0);
-        // restore to append mode for uc_hook_add()
-        uc->hook_insert = 0;
-        if (err != UC_ERR_OK) {
-            uc->nested_level--;
-            return err;
-        }
-    }
-
     // If UC_CTL_UC_USE_EXITS is set, then the @until param won't have any
     // effect. This is designed for the backward compatibility.
     if (!uc->use_exits) {
         uc->exits[uc->nested_level - 1] = until;
     }
 
+    // The deadline is polled by the translated code at TB boundaries, see
+    // helper_check_exit_request(). A nested uc_emu_start() can only shorten
+    // the deadline of the outer one.
+    prev_deadline = uc->timeout_deadline;
     if (timeout) {
-        enable_emu_timer(uc, timeout * 1000); // microseconds -> nanoseconds
+        uc->timeout = timeout * 1000; // microseconds -> nanoseconds
+        deadline = get_clock() + uc->timeout;
+        if (!prev_deadline || deadline < prev_deadline) {
+            uc->timeout_deadline = deadline;
+            uc->timeout_poll = 1;
+        }
+    }
+
+    // The instruction budget is charged per TB by its prologue, see
+    // helper_check_exit_request(). A nested uc_emu_start() gets a budget of
+    // its own.
+    prev_count = uc->emu_count;
+    prev_counter = uc->emu_counter;
+    uc->emu_count = count;
+    uc->emu_counter = 0;
+
+    // A superblock is charged as a whole but may leave early, see
+    // UC_CTL_TB_SUPERBLOCK.
+    if (count && uc->nested_level == 1 && uc->tb_superblocks) {
+        uc->tb_flush(uc);
+    }
+
+    // every run starts a new path through the coverage bitmap
+    if (uc->nested_level == 1) {
+        uc->cpu->cov_prev_loc = 0;
     }
 
     uc->vm_start(uc);
 
+    uc->timeout_deadline = prev_deadline;
+    uc->emu_count = prev_count;
+    uc->emu_counter = prev_counter;
+
     uc->nested_level--;
 
     // emulation is done if and only if we exit the outer uc_emu_start
@@ -1241,11 +1519,6 @@ uc_err uc_emu_start(uc_engine *uc, uint64_t begin, uint64_t until,
         restore_jit_state(uc);
     }
 
-    if (timeout) {
-        // wait for the timer to finish
-        qemu_thread_join(&uc->timer);
-    }
-
     // We may be in a nested uc_emu_start and thus clear invalid_error
     // once we are done.
     err = uc->invalid_error;
@@ -1350,6 +1623,53 @@ static uc_err mem_map(uc_engine *uc, MemoryRegion *block)
     return UC_ERR_OK;
 }
 
+// insert blocks sorted by address into mapped_blocks with a single merge
+static void mem_map_blocks(uc_engine *uc, MemoryRegion **blocks, uint32_t n)
+{
+    uint32_t total = uc->mapped_block_count + n;
+    int64_t i = (int64_t)uc->mapped_block_count - 1;
+    int64_t j = (int64_t)n - 1;
+    int64_t k = (int64_t)total - 1;
+
+    uc->mapped_blocks = (MemoryRegion **)g_realloc(
+        uc->mapped_blocks, sizeof(MemoryRegion *) *
+                               ROUND_UP(total, MEM_BLOCK_INCR));
+
+    while (j >= 0) {
+        if (i >= 0 && uc->mapped_blocks[i]->addr > blocks[j]->addr) {
+            uc->mapped_blocks[k--] = uc->mapped_blocks[i--];
+        } else {
+            uc->mapped_blocks[k--] = blocks[j--];
+        }
+    }
+    uc->mapped_block_count = total;
+}
+
+static int mem_region_cmp(const void *a, const void *b)
+{
+    const uc_mem_region *ra = a, *rb = b;
+
+    return ra->begin < rb->begin ? -1 : ra->begin > rb->begin;
+}
+
+// sort a copy of regions and make sure they don't overlap each other
+static uc_mem_region *mem_regions_sorted(const uc_mem_region *regions,
+                                         uint32_t count)
+{
+    uc_mem_region *sorted = g_memdup(regions, sizeof(*regions) * count);
+    uint32_t i;
+
+    qsort(sorted, count, sizeof(*sorted), mem_region_cmp);
+    for (i = 0; i < count; i++) {
+        if (sorted[i].end < sorted[i].begin ||
+            (i > 0 && sorted[i].begin <= sorted[i - 1].end)) {
+            g_free(sorted);
+            return NULL;
+        }
+    }
+    return sorted;
+}
+
 static uc_err mem_map_check(uc_engine *uc, uint64_t address, uint64_t size,
                             uint32_t perms)
 {
@@ -1548,11 +1868,57 @@ static bool split_mmio_region(struct uc_struct *uc, MemoryRegion *mr,
     return true;
 }
 
+// Give the pages [address, address + size) of the RAM block mr new
+// permissions. Only the pages changed are written to, the block keeps its
+// memory and stays mapped as a whole.
+static void mem_protect_ram(struct uc_struct *uc, MemoryRegion *mr,
+                            uint64_t address, uint64_t size, uint32_t perms)
+{
+    uint64_t pages = int128_get64(mr->size) / uc->target_page_size;
+    uint64_t first =
+        (address - memory_region_start(uc, mr)) / uc->target_page_size;
+    uint64_t count = size / uc->target_page_size;
+
+    if (count == pages) {
+        // all pages agree again
+        g_free(mr->page_perms);
+        mr->page_perms = NULL;
+        mr->perms = perms;
+    } else {
+        if (!mr->page_perms) {
+            mr->page_perms = g_malloc(pages);
+            memset(mr->page_perms, mr->perms, pages);
+        }
+        memset(mr->page_perms + first, perms, count);
+        // a union that is too wide only costs a slow path access
+        mr->perms |= perms;
+    }
+    uc->readonly_mem(mr, (mr->perms & UC_PROT_WRITE) == 0);
+}
+
+// Apply the page permissions saved from a block that got split up to the
+// block now mapped at [address, address + size).
+static void mem_protect_pages(struct uc_struct *uc, uint64_t address,
+                              uint64_t size, const uint8_t *page_perms)
+{
+    MemoryRegion *mr = uc->memory_mapping(uc, address);
+    uint64_t pages = size / uc->target_page_size;
+    uint64_t i, run;
+
+    for (i = 0; i < pages; i += run) {
+        for (run = 1; i + run < pages && page_perms[i + run] == page_perms[i];
+             run++) {
+        }
+        mem_protect_ram(uc, mr, address + i * uc->target_page_size,
+                        run * uc->target_page_size, page_perms[i]);
+    }
+}
+
 /*
    Split the given MemoryRegion at the indicated address for the indicated size
    this may result in the create of up to 3 spanning sections. If the delete
    parameter is true, the no new section will be created to replace the indicate
-   range. This functions exists to support uc_mem_protect and uc_mem_unmap.
+   range. This functions exists to support uc_mem_unmap.
 
    This is a static function and callers have already done some preliminary
    parameter validation.
@@ -1567,6 +1933,7 @@ static bool split_region(struct uc_struct *uc, MemoryRegion *mr,
                          uint64_t address, uint64_t size, bool do_delete)
 {
     uint8_t *backup;
+    uint8_t *page_perms;
     uint32_t perms;
     uint64_t begin, end, chunk_end;
     uint64_t l_size, m_size, r_size;
@@ -1615,6 +1982,8 @@ static bool split_region(struct uc_struct *uc, MemoryRegion *mr,
     // save the essential information required for the split before mr gets
     // deleted
     perms = mr->perms;
+    page_perms = mr->page_perms;
+    mr->page_perms = NULL;
     begin = mr->addr;
     end = mr->end;
 
@@ -1697,12 +2066,29 @@ static bool split_region(struct uc_struct *uc, MemoryRegion *mr,
         }
     }
 
+    if (page_perms) {
+        if (l_size > 0) {
+            mem_protect_pages(uc, begin, l_size, page_perms);
+        }
+        if (m_size > 0 && !do_delete) {
+            mem_protect_pages(uc, address, m_size,
+                              page_perms + l_size / uc->target_page_size);
+        }
+        if (r_size > 0) {
+            mem_protect_pages(uc, chunk_end, r_size,
+                              page_perms + (l_size + m_size) /
+                                               uc->target_page_size);
+        }
+        g_free(page_perms);
+    }
+
     if (!prealloc) {
         free(backup);
     }
     return true;
 
 error:
+    g_free(page_perms);
     if (!prealloc) {
         free(backup);
     }
@@ -1760,26 +2146,21 @@ uc_err uc_mem_protect(struct uc_struct *uc, uint64_t address, uint64_t size,
     }
 
     // Now we know entire region is mapped, so change permissions
-    // We may need to split regions if this area spans adjacent regions
+    // RAM keeps per page permissions, MMIO regions still have to be split
     addr = address;
     count = 0;
     while (count < size) {
         mr = uc->memory_mapping(uc, addr);
         len = memory_region_len(uc, mr, addr, size - count);
         if (mr->ram) {
-            if (!split_region(uc, mr, addr, len, false)) {
-                restore_jit_state(uc);
-                return UC_ERR_NOMEM;
-            }
-
-            mr = uc->memory_mapping(uc, addr);
             // will this remove EXEC permission?
             if (((mr->perms & UC_PROT_EXEC) != 0) &&
                 ((perms & UC_PROT_EXEC) == 0)) {
                 remove_exec = true;
+                // chained TBs would still jump into the pages
+                uc->uc_invalidate_tb(uc, addr, len);
             }
-            mr->perms = perms;
-            uc->readonly_mem(mr, (perms & UC_PROT_WRITE) == 0);
+            mem_protect_ram(uc, mr, addr, len, perms);
 
         } else {
             if (!split_mmio_region(uc, mr, addr, len, false)) {
@@ -1795,6 +2176,9 @@ uc_err uc_mem_protect(struct uc_struct *uc, uint64_t address, uint64_t size,
         addr += len;
     }
 
+    // the pages may be mapped anywhere in the guest virtual address space
+    uc->tcg_flush_tlb(uc);
+
     // if EXEC permission is removed, then quit TB and continue at the same
     // place
     if (remove_exec) {
@@ -1864,44 +2248,183 @@ uc_err uc_mem_unmap(struct uc_struct *uc, uint64_t address, uint64_t size)
         restore_jit_state(uc);
         return UC_ERR_NOMEM;
     }
-
-    if (uc->snapshot_level > 0) {
-        uc_err res = uc_mem_unmap_snapshot(uc, address, size, NULL);
+
+    if (uc->snapshot_level > 0) {
+        uc_err res = uc_mem_unmap_snapshot(uc, address, size, NULL);
+        restore_jit_state(uc);
+        return res;
+    }
+
+    // Now we know entire region is mapped, so do the unmap
+    // We may need to split regions if this area spans adjacent regions
+    addr = address;
+    count = 0;
+    while (count < size) {
+        mr = uc->memory_mapping(uc, addr);
+        len = memory_region_len(uc, mr, addr, size - count);
+        if (!mr->ram) {
+            if (!split_mmio_region(uc, mr, addr, len, true)) {
+                restore_jit_state(uc);
+                return UC_ERR_NOMEM;
+            }
+        } else {
+            if (!split_region(uc, mr, addr, len, true)) {
+                restore_jit_state(uc);
+                return UC_ERR_NOMEM;
+            }
+        }
+
+        // if we can retrieve the mapping, then no splitting took place
+        // so unmap here
+        mr = uc->memory_mapping(uc, addr);
+        if (mr != NULL) {
+            uc->memory_unmap(uc, mr);
+        }
+        count += len;
+        addr += len;
+    }
+
+    restore_jit_state(uc);
+    return UC_ERR_OK;
+}
+
+UNICORN_EXPORT
+uc_err uc_mem_map_batch(uc_engine *uc, const uc_mem_region *regions,
+                        uint32_t count)
+{
+    uc_mem_region *sorted;
+    MemoryRegion **blocks;
+    uc_err res = UC_ERR_OK;
+    uint32_t i;
+
+    UC_INIT(uc);
+
+    if (count == 0) {
+        restore_jit_state(uc);
+        return UC_ERR_OK;
+    }
+
+    sorted = mem_regions_sorted(regions, count);
+    if (sorted == NULL) {
+        restore_jit_state(uc);
+        return UC_ERR_ARG;
+    }
+
+    // nothing gets mapped unless all regions can be
+    for (i = 0; i < count; i++) {
+        res = mem_map_check(uc, sorted[i].begin,
+                            sorted[i].end - sorted[i].begin + 1,
+                            sorted[i].perms);
+        if (res != UC_ERR_OK) {
+            g_free(sorted);
+            restore_jit_state(uc);
+            return res;
+        }
+    }
+
+    blocks = g_new(MemoryRegion *, count);
+    uc->memory_transaction_begin(uc);
+    for (i = 0; i < count; i++) {
+        blocks[i] = uc->memory_map(uc, sorted[i].begin,
+                                   sorted[i].end - sorted[i].begin + 1,
+                                   sorted[i].perms);
+        if (blocks[i] == NULL) {
+            res = UC_ERR_NOMEM;
+            break;
+        }
+    }
+    uc->memory_transaction_commit(uc);
+
+    if (res == UC_ERR_OK) {
+        mem_map_blocks(uc, blocks, count);
+    } else {
+        uc->memory_unmap_batch(uc, blocks, i);
+    }
+
+    g_free(blocks);
+    g_free(sorted);
+    restore_jit_state(uc);
+    return res;
+}
+
+UNICORN_EXPORT
+uc_err uc_mem_unmap_batch(uc_engine *uc, const uc_mem_region *regions,
+                          uint32_t count)
+{
+    uc_mem_region *sorted;
+    MemoryRegion **blocks;
+    MemoryRegion *mr;
+    uint64_t size;
+    uint32_t i, j, first, nblocks = 0, nsplit = 0;
+    bool whole;
+    uc_err res = UC_ERR_OK;
+
+    UC_INIT(uc);
+
+    if (count == 0) {
+        restore_jit_state(uc);
+        return UC_ERR_OK;
+    }
+
+    sorted = mem_regions_sorted(regions, count);
+    if (sorted == NULL) {
+        restore_jit_state(uc);
+        return UC_ERR_ARG;
+    }
+
+    // nothing gets unmapped unless all regions can be
+    for (i = 0; i < count; i++) {
+        size = sorted[i].end - sorted[i].begin + 1;
+        if (((sorted[i].begin | size) & uc->target_page_align) != 0) {
+            res = UC_ERR_ARG;
+            break;
+        }
+        if (!check_mem_area(uc, sorted[i].begin, size)) {
+            res = UC_ERR_NOMEM;
+            break;
+        }
+    }
+    if (res != UC_ERR_OK) {
+        g_free(sorted);
         restore_jit_state(uc);
         return res;
     }
 
-    // Now we know entire region is mapped, so do the unmap
-    // We may need to split regions if this area spans adjacent regions
-    addr = address;
-    count = 0;
-    while (count < size) {
-        mr = uc->memory_mapping(uc, addr);
-        len = memory_region_len(uc, mr, addr, size - count);
-        if (!mr->ram) {
-            if (!split_mmio_region(uc, mr, addr, len, true)) {
-                restore_jit_state(uc);
-                return UC_ERR_NOMEM;
+    // Regions made of whole blocks go away together, the others have to be
+    // split or saved for a snapshot by uc_mem_unmap().
+    blocks = g_new(MemoryRegion *, uc->mapped_block_count);
+    for (i = 0; i < count; i++) {
+        first = bsearch_mapped_blocks(uc, sorted[i].begin);
+        whole = uc->snapshot_level == 0;
+        for (j = first; whole && j < uc->mapped_block_count &&
+                        uc->mapped_blocks[j]->addr <= sorted[i].end;
+             j++) {
+            mr = uc->mapped_blocks[j];
+            whole = mr->container == uc->system_memory &&
+                    mr->addr >= sorted[i].begin &&
+                    mr->end - 1 <= sorted[i].end;
+        }
+        if (whole) {
+            for (j = first; j < uc->mapped_block_count &&
+                            uc->mapped_blocks[j]->addr <= sorted[i].end;
+                 j++) {
+                blocks[nblocks++] = uc->mapped_blocks[j];
             }
         } else {
-            if (!split_region(uc, mr, addr, len, true)) {
-                restore_jit_state(uc);
-                return UC_ERR_NOMEM;
-            }
+            sorted[nsplit++] = sorted[i];
         }
+    }
+    uc->memory_unmap_batch(uc, blocks, nblocks);
+    g_free(blocks);
 
-        // if we can retrieve the mapping, then no splitting took place
-        // so unmap here
-        mr = uc->memory_mapping(uc, addr);
-        if (mr != NULL) {
-            uc->memory_unmap(uc, mr);
-        }
-        count += len;
-        addr += len;
+    for (i = 0; i < nsplit && res == UC_ERR_OK; i++) {
+        res = uc_mem_unmap(uc, sorted[i].begin,
+                           sorted[i].end - sorted[i].begin + 1);
     }
 
+    g_free(sorted);
     restore_jit_state(uc);
-    return UC_ERR_OK;
+    return res;
 }
 
 UNICORN_EXPORT
@@ -1929,6 +2452,7 @@ uc_err uc_hook_add(uc_engine *uc, uc_hook *hh, int type, void *callback,
     hook->hooked_regions = g_hash_table_new_full(
         hooked_regions_hash, hooked_regions_equal, g_free, NULL);
     *hh = (uc_hook)hook;
+    uc->hooks_gen++;
 
     // UC_HOOK_INSN has an extra argument for instruction ID
     if (type & UC_HOOK_INSN) {
@@ -2017,6 +2541,9 @@ uc_err uc_hook_add(uc_engine *uc, uc_hook *hh, int type, void *callback,
                     }
                 }
                 uc->hooks_count[i]++;
+                if (i == UC_HOOK_CODE_IDX || i == UC_HOOK_BLOCK_IDX) {
+                    hook_invalidate_added(uc, i, hook);
+                }
             }
         }
         i++;
@@ -2026,6 +2553,10 @@ uc_err uc_hook_add(uc_engine *uc, uc_hook *hh, int type, void *callback,
     // TODO: return an error?
     if (hook->refs == 0) {
         free(hook);
+    } else if (type & (UC_HOOK_MEM_READ | UC_HOOK_MEM_READ_AFTER |
+                       UC_HOOK_MEM_WRITE)) {
+        // re-tag the TLB so that hooked pages leave the inline fast path
+        uc->tcg_flush_tlb(uc);
     }
 
     restore_jit_state(uc);
@@ -2037,6 +2568,7 @@ uc_err uc_hook_del(uc_engine *uc, uc_hook hh)
 {
     int i;
     struct hook *hook = (struct hook *)hh;
+    bool flush_tlb = false;
 
     UC_INIT(uc);
 
@@ -2051,11 +2583,21 @@ uc_err uc_hook_del(uc_engine *uc, uc_hook hh)
                                  uc);
             g_hash_table_remove_all(hook->hooked_regions);
             hook->to_delete = true;
+            uc->hooks_gen++;
             uc->hooks_count[i]--;
             hook_append(&uc->hooks_to_del, hook);
+            if (i == UC_HOOK_MEM_READ_IDX || i == UC_HOOK_MEM_READ_AFTER_IDX ||
+                i == UC_HOOK_MEM_WRITE_IDX) {
+                flush_tlb = true;
+            }
         }
     }
 
+    // pages no longer hooked may go back to the inline fast path
+    if (flush_tlb) {
+        uc->tcg_flush_tlb(uc);
+    }
+
     restore_jit_state(uc);
     return UC_ERR_OK;
 }
@@ -2094,13 +2636,108 @@ void helper_uc_traceopcode(struct hook *hook, uint64_t arg1, uint64_t arg2,
     }
 }
 
+static int hook_index_cmp(const void *a, const void *b)
+{
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+
+    return x < y ? -1 : x > y;
+}
+
+// whether hook covers the whole segment starting at start
+static inline bool hook_index_covers(struct hook *hook, uint64_t start)
+{
+    return hook->begin > hook->end ||
+           (hook->begin <= start && start <= hook->end);
+}
+
+void hook_index_rebuild(struct uc_struct *uc, int idx)
+{
+    struct hook_index *hi = &uc->hook_index[idx];
+    struct list_item *cur;
+    struct hook *hook;
+    uint64_t *points;
+    size_t npoints = 1, nseg = 0, total = 0, i;
+    char *mem;
+
+    // every hook boundary starts a new segment
+    for (cur = uc->hook[idx].head; cur != NULL; cur = cur->next) {
+        npoints += 2;
+    }
+    points = g_new(uint64_t, npoints);
+    points[0] = 0;
+    npoints = 1;
+    for (cur = uc->hook[idx].head;
+         cur != NULL && (hook = (struct hook *)cur->data); cur = cur->next) {
+        if (hook->to_delete || hook->begin > hook->end) {
+            continue;
+        }
+        points[npoints++] = hook->begin;
+        if (hook->end != UINT64_MAX) {
+            points[npoints++] = hook->end + 1;
+        }
+    }
+    qsort(points, npoints, sizeof(uint64_t), hook_index_cmp);
+    for (i = 0; i < npoints; i++) {
+        if (i == 0 || points[i] != points[nseg - 1]) {
+            points[nseg++] = points[i];
+        }
+    }
+
+    for (i = 0; i < nseg; i++) {
+        for (cur = uc->hook[idx].head;
+             cur != NULL && (hook = (struct hook *)cur->data);
+             cur = cur->next) {
+            if (!hook->to_delete && hook_index_covers(hook, points[i])) {
+                total++;
+            }
+        }
+    }
+
+    mem = g_malloc(nseg * sizeof(uint64_t) + total * sizeof(struct hook *) +
+                   (nseg + 1) * sizeof(uint32_t));
+
+    // A dispatch further up the stack may still walk the old arrays, so they
+    // are only released once emulation is over.
+    if (hi->mem) {
+        if (uc->nested_level) {
+            list_append(&uc->hook_index_retired, hi->mem);
+        } else {
+            g_free(hi->mem);
+        }
+    }
+
+    hi->mem = mem;
+    hi->starts = (uint64_t *)mem;
+    hi->hooks = (struct hook **)(hi->starts + nseg);
+    hi->offs = (uint32_t *)(hi->hooks + total);
+    hi->nseg = nseg;
+
+    memcpy(hi->starts, points, nseg * sizeof(uint64_t));
+    total = 0;
+    for (i = 0; i < nseg; i++) {
+        hi->offs[i] = total;
+        for (cur = uc->hook[idx].head;
+             cur != NULL && (hook = (struct hook *)cur->data);
+             cur = cur->next) {
+            if (!hook->to_delete && hook_index_covers(hook, points[i])) {
+                hi->hooks[total++] = hook;
+            }
+        }
+    }
+    hi->offs[nseg] = total;
+    hi->gen = uc->hooks_gen;
+
+    g_free(points);
+}
+
 void helper_uc_tracecode(int32_t size, uc_hook_idx index, void *handle,
                          int64_t address);
 void helper_uc_tracecode(int32_t size, uc_hook_idx index, void *handle,
                          int64_t address)
 {
     struct uc_struct *uc = handle;
-    struct list_item *cur;
+    HOOK_FOREACH_BOUNDED_VAR_DECLARE;
     struct hook *hook;
     int hook_flags =
         index &
@@ -2127,24 +2764,17 @@ void helper_uc_tracecode(int32_t size, uc_hook_idx index, void *handle,
         revert_uc_emu_stop(uc);
     }
 
-    for (cur = uc->hook[index].head;
-         cur != NULL && (hook = (struct hook *)cur->data); cur = cur->next) {
+    // on invalid block/instruction, quit
+    if (size == 0) {
+        return;
+    }
+
+    for (hcur = hook_index_lookup(uc, index, (uint64_t)address, &hend);
+         hcur < hend && (hook = *hcur); hcur++) {
         if (hook->to_delete) {
             continue;
         }
 
-        // on invalid block/instruction, call instruction counter (if enable),
-        // then quit
-        if (size == 0) {
-            if (index == UC_HOOK_CODE_IDX && uc->count_hook) {
-                // this is the instruction counter (first hook in the list)
-                JIT_CALLBACK_GUARD(((uc_cb_hookcode_t)hook->callback)(
-                    uc, address, size, hook->user_data));
-            }
-
-            return;
-        }
-
         if (HOOK_BOUND_CHECK(hook, (uint64_t)address)) {
             JIT_CALLBACK_GUARD(((uc_cb_hookcode_t)hook->callback)(
                 uc, address, size, hook->user_data));
@@ -2167,12 +2797,27 @@ void helper_uc_tracecode(int32_t size, uc_hook_idx index, void *handle,
 UNICORN_EXPORT
 uc_err uc_mem_regions(uc_engine *uc, uc_mem_region **regions, uint32_t *count)
 {
-    uint32_t i;
+    uint32_t i, n;
+    uint64_t page, pages;
+    MemoryRegion *mr;
     uc_mem_region *r = NULL;
 
     UC_INIT(uc);
 
-    *count = uc->mapped_block_count;
+    // blocks with page permissions are reported once per run of pages
+    *count = 0;
+    for (i = 0; i < uc->mapped_block_count; i++) {
+        mr = uc->mapped_blocks[i];
+        (*count)++;
+        if (mr->page_perms) {
+            pages = int128_get64(mr->size) / uc->target_page_size;
+            for (page = 1; page < pages; page++) {
+                if (mr->page_perms[page] != mr->page_perms[page - 1]) {
+                    (*count)++;
+                }
+            }
+        }
+    }
 
     if (*count) {
         r = g_malloc0(*count * sizeof(uc_mem_region));
@@ -2183,10 +2828,25 @@ uc_err uc_mem_regions(uc_engine *uc, uc_mem_region **regions, uint32_t *count)
         }
     }
 
-    for (i = 0; i < *count; i++) {
-        r[i].begin = uc->mapped_blocks[i]->addr;
-        r[i].end = uc->mapped_blocks[i]->end - 1;
-        r[i].perms = uc->mapped_blocks[i]->perms;
+    for (i = 0, n = 0; i < uc->mapped_block_count; i++) {
+        mr = uc->mapped_blocks[i];
+        r[n].begin = mr->addr;
+        r[n].end = mr->end - 1;
+        r[n].perms = mr->perms;
+        if (mr->page_perms) {
+            pages = int128_get64(mr->size) / uc->target_page_size;
+            r[n].perms = mr->page_perms[0];
+            for (page = 1; page < pages; page++) {
+                if (mr->page_perms[page] != mr->page_perms[page - 1]) {
+                    r[n].end = mr->addr + page * uc->target_page_size - 1;
+                    n++;
+                    r[n].begin = r[n - 1].end + 1;
+                    r[n].end = mr->end - 1;
+                    r[n].perms = mr->page_perms[page];
+                }
+            }
+        }
+        n++;
     }
 
     *regions = r;
@@ -2619,6 +3279,172 @@ static inline gboolean uc_read_exit_iter(gpointer key, gpointer val,
     return false;
 }
 
+// UC_CTL_TB_CACHE_EXPORT file layout: a header followed by count entries,
+// in host byte order.
+#define UC_TB_CACHE_MAGIC 0x43425455 // "UTBC"
+#define UC_TB_CACHE_VERSION 1
+
+typedef struct uc_tb_cache_header {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t arch;
+    uint32_t mode;
+    uint32_t cpu_model;
+    uint32_t count;
+} uc_tb_cache_header;
+
+typedef struct uc_tb_cache_entry {
+    uint64_t pc;
+    uint64_t cs_base;
+    uint64_t hash; // of the guest bytes covered by the TB
+    uint32_t flags;
+    uint32_t cflags;
+    uint32_t size;
+    uint32_t reserved;
+} uc_tb_cache_entry;
+
+typedef struct uc_tb_cache_export_ctx {
+    FILE *fp;
+    uint32_t count;
+    uc_err err;
+} uc_tb_cache_export_ctx;
+
+// Hash the guest code covered by a TB (FNV-1a)
+static uc_err tb_cache_hash(uc_engine *uc, uint64_t pc, uint32_t size,
+                            uint64_t *hash)
+{
+    uint8_t *buf = g_malloc(size);
+    uint64_t h = 0xcbf29ce484222325ULL;
+    uint32_t i;
+    uc_err err;
+
+    err = vmem_read(uc, pc, UC_PROT_EXEC, buf, size);
+    if (err == UC_ERR_OK) {
+        for (i = 0; i < size; i++) {
+            h = (h ^ buf[i]) * 0x100000001b3ULL;
+        }
+        *hash = h;
+    }
+
+    g_free(buf);
+    return err;
+}
+
+static void tb_cache_export_cb(struct uc_struct *uc, const uc_tb_key *key,
+                               void *opaque)
+{
+    uc_tb_cache_export_ctx *ctx = opaque;
+    uc_tb_cache_entry entry = {0};
+
+    if (ctx->err != UC_ERR_OK) {
+        return;
+    }
+
+    // the code may have been unmapped since it was translated
+    if (tb_cache_hash(uc, key->pc, key->size, &entry.hash) != UC_ERR_OK) {
+        return;
+    }
+
+    entry.pc = key->pc;
+    entry.cs_base = key->cs_base;
+    entry.flags = key->flags;
+    entry.cflags = key->cflags;
+    entry.size = key->size;
+    if (fwrite(&entry, sizeof(entry), 1, ctx->fp) != 1) {
+        ctx->err = UC_ERR_RESOURCE;
+        return;
+    }
+    ctx->count++;
+}
+
+static uc_err tb_cache_export(uc_engine *uc, const char *path)
+{
+    uc_tb_cache_header header = {UC_TB_CACHE_MAGIC, UC_TB_CACHE_VERSION,
+                                 uc->arch, uc->mode, uc->cpu_model, 0};
+    uc_tb_cache_export_ctx ctx = {NULL, 0, UC_ERR_OK};
+
+    ctx.fp = fopen(path, "wb");
+    if (ctx.fp == NULL) {
+        return UC_ERR_ARG;
+    }
+
+    if (fwrite(&header, sizeof(header), 1, ctx.fp) != 1) {
+        ctx.err = UC_ERR_RESOURCE;
+    } else {
+        uc->uc_tb_foreach(uc, tb_cache_export_cb, &ctx);
+    }
+
+    // now that the number of entries is known
+    if (ctx.err == UC_ERR_OK) {
+        header.count = ctx.count;
+        if (fseek(ctx.fp, 0, SEEK_SET) != 0 ||
+            fwrite(&header, sizeof(header), 1, ctx.fp) != 1) {
+            ctx.err = UC_ERR_RESOURCE;
+        }
+    }
+
+    if (fclose(ctx.fp) != 0 && ctx.err == UC_ERR_OK) {
+        ctx.err = UC_ERR_RESOURCE;
+    }
+    return ctx.err;
+}
+
+static uc_err tb_cache_import(uc_engine *uc, const char *path, size_t *count)
+{
+    uc_tb_cache_header header;
+    uc_tb_cache_entry entry;
+    uc_tb_key key;
+    uint64_t hash;
+    uc_err err = UC_ERR_OK;
+    size_t loaded = 0;
+    uint32_t i;
+    FILE *fp;
+
+    fp = fopen(path, "rb");
+    if (fp == NULL) {
+        return UC_ERR_ARG;
+    }
+
+    if (fread(&header, sizeof(header), 1, fp) != 1 ||
+        header.magic != UC_TB_CACHE_MAGIC ||
+        header.version != UC_TB_CACHE_VERSION || header.arch != uc->arch ||
+        header.mode != uc->mode || header.cpu_model != uc->cpu_model) {
+        fclose(fp);
+        return UC_ERR_ARG;
+    }
+
+    for (i = 0; i < header.count; i++) {
+        if (fread(&entry, sizeof(entry), 1, fp) != 1) {
+            err = UC_ERR_ARG;
+            break;
+        }
+
+        // skip the code which changed or went away since the export
+        if (entry.size == 0 ||
+            tb_cache_hash(uc, entry.pc, entry.size, &hash) != UC_ERR_OK ||
+            hash != entry.hash) {
+            continue;
+        }
+
+        key.pc = entry.pc;
+        key.cs_base = entry.cs_base;
+        key.flags = entry.flags;
+        key.cflags = entry.cflags;
+        key.size = entry.size;
+        err = uc->uc_gen_tb_key(uc, &key);
+        if (err != UC_ERR_OK) {
+            break;
+        }
+        loaded++;
+    }
+
+    fclose(fp);
+    if (count) {
+        *count = loaded;
+    }
+    return err;
+}
+
 UNICORN_EXPORT
 uc_err uc_ctl(uc_engine *uc, uc_control_type control, ...)
 {
@@ -2885,6 +3711,31 @@ uc_err uc_ctl(uc_engine *uc, uc_control_type control, ...)
         break;
     }
 
+    case UC_CTL_TB_REQUEST_CACHE_BATCH: {
+
+        UC_INIT(uc);
+
+        if (rw == UC_CTL_IO_READ_WRITE) {
+            const uint64_t *addrs = va_arg(args, const uint64_t *);
+            size_t count = va_arg(args, size_t);
+            uint32_t depth = va_arg(args, uint32_t);
+            size_t budget = va_arg(args, size_t);
+            size_t *generated = va_arg(args, size_t *);
+            size_t *used = va_arg(args, size_t *);
+            if (addrs == NULL && count != 0) {
+                err = UC_ERR_ARG;
+            } else {
+                err = uc->uc_gen_tb_batch(uc, addrs, count, depth, budget,
+                                          generated, used);
+            }
+        } else {
+            err = UC_ERR_ARG;
+        }
+
+        restore_jit_state(uc);
+        break;
+    }
+
     case UC_CTL_TB_REMOVE_CACHE: {
 
         UC_INIT(uc);
@@ -2905,6 +3756,35 @@ uc_err uc_ctl(uc_engine *uc, uc_control_type control, ...)
         break;
     }
 
+    case UC_CTL_TB_CACHE_EXPORT:
+
+        UC_INIT(uc);
+
+        if (rw == UC_CTL_IO_WRITE) {
+            const char *path = va_arg(args, const char *);
+            err = tb_cache_export(uc, path);
+        } else {
+            err = UC_ERR_ARG;
+        }
+
+        restore_jit_state(uc);
+        break;
+
+    case UC_CTL_TB_CACHE_IMPORT:
+
+        UC_INIT(uc);
+
+        if (rw == UC_CTL_IO_READ_WRITE) {
+            const char *path = va_arg(args, const char *);
+            size_t *count = va_arg(args, size_t *);
+            err = tb_cache_import(uc, path, count);
+        } else {
+            err = UC_ERR_ARG;
+        }
+
+        restore_jit_state(uc);
+        break;
+
     case UC_CTL_TB_FLUSH:
 
         UC_INIT(uc);
@@ -2977,6 +3857,110 @@ uc_err uc_ctl(uc_engine *uc, uc_control_type control, ...)
         restore_jit_state(uc);
         break;
 
+    case UC_CTL_SNAPSHOT_TYPE:
+
+        UC_INIT(uc);
+
+        if (rw == UC_CTL_IO_WRITE) {
+            int mode = va_arg(args, int);
+            if (mode != UC_SNAPSHOT_REGION && mode != UC_SNAPSHOT_PAGE) {
+                err = UC_ERR_ARG;
+            } else if (uc->snapshot_level > 0 && mode != uc->snapshot_type) {
+                // the backends can't be mixed within a snapshot
+                err = UC_ERR_ARG;
+            } else {
+                uc->snapshot_type = mode;
+                err = UC_ERR_OK;
+            }
+        } else {
+            int *mode = va_arg(args, int *);
+            *mode = uc->snapshot_type;
+            err = UC_ERR_OK;
+        }
+
+        restore_jit_state(uc);
+        break;
+
+    case UC_CTL_TB_INLINE_CACHE:
+
+        UC_INIT(uc);
+
+        if (rw == UC_CTL_IO_WRITE) {
+            int flags = va_arg(args, int);
+            if (flags & ~(UC_TB_IC_INDIRECT | UC_TB_IC_RETURN)) {
+                err = UC_ERR_ARG;
+            } else {
+                if (flags != uc->tb_inline_cache) {
+                    // the caches are generated into the TBs
+                    uc->tb_inline_cache = flags;
+                    uc->tb_flush(uc);
+                }
+                err = UC_ERR_OK;
+            }
+        } else {
+            int *flags = va_arg(args, int *);
+            *flags = uc->tb_inline_cache;
+            err = UC_ERR_OK;
+        }
+
+        restore_jit_state(uc);
+        break;
+
+    case UC_CTL_TB_SUPERBLOCK:
+
+        UC_INIT(uc);
+
+        if (uc->arch != UC_ARCH_X86 && uc->arch != UC_ARCH_ARM64) {
+            err = UC_ERR_ARCH;
+        } else if (rw == UC_CTL_IO_WRITE) {
+            uint32_t threshold = va_arg(args, uint32_t);
+            if (threshold != uc->tb_superblock_threshold) {
+                // the execution counters are generated into the TBs
+                uc->tb_superblock_threshold = threshold;
+                uc->tb_flush(uc);
+            }
+            err = UC_ERR_OK;
+        } else {
+            uint32_t *threshold = va_arg(args, uint32_t *);
+            *threshold = uc->tb_superblock_threshold;
+            err = UC_ERR_OK;
+        }
+
+        restore_jit_state(uc);
+        break;
+
+    case UC_CTL_COVERAGE_BITMAP:
+
+        UC_INIT(uc);
+
+        if (rw == UC_CTL_IO_WRITE) {
+            uint8_t *map = va_arg(args, uint8_t *);
+            size_t size = va_arg(args, size_t);
+            if (map && (size == 0 || (size & (size - 1)) ||
+                        size > ((size_t)1 << 31))) {
+                err = UC_ERR_ARG;
+            } else {
+                if (map != uc->coverage_map ||
+                    (map && size != uc->coverage_size)) {
+                    // the bitmap and its mask are generated into the TBs
+                    uc->coverage_map = map;
+                    uc->coverage_size = map ? size : 0;
+                    uc->cpu->cov_prev_loc = 0;
+                    uc->tb_flush(uc);
+                }
+                err = UC_ERR_OK;
+            }
+        } else {
+            uint8_t **map = va_arg(args, uint8_t **);
+            size_t *size = va_arg(args, size_t *);
+            *map = uc->coverage_map;
+            *size = uc->coverage_size;
+            err = UC_ERR_OK;
+        }
+
+        restore_jit_state(uc);
+        break;
+
     default:
         err = UC_ERR_ARG;
         break;
@@ -2993,6 +3977,7 @@ static uc_err uc_snapshot(struct uc_struct *uc)
         return UC_ERR_RESOURCE;
     }
     uc->snapshot_level++;
+    uc->snapshot_gen++;
     return UC_ERR_OK;
 }
 
@@ -3001,6 +3986,10 @@ static uc_err uc_restore_latest_snapshot(struct uc_struct *uc)
     MemoryRegion *subregion, *subregion_next, *mr, *initial_mr;
     int level;
 
+    // copy back the pages saved by the UC_SNAPSHOT_PAGE backend before the
+    // regions mapped after the snapshot go away
+    uc->memory_restore_pages(uc);
+
     QTAILQ_FOREACH_SAFE(subregion, &uc->system_memory->subregions,
                         subregions_link, subregion_next)
     {